@@ -1,7 +1,35 @@
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 #include <vector>
 #include <queue>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <random>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+#include <cstddef>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#endif
 using namespace std;
 
 struct Pos {
@@ -14,164 +42,3981 @@ struct Pos {
     }
 };
 
+// Index of a cell in the padded row-major grid used by Maze and PathFinder
+typedef size_t Cell;
+
+// Moves in the order the path finders probe the neighbors of a cell. The
+// diagonal moves of 8-connected neighborhoods are numbered so that d ^ 2
+// reverses any move, as it does the orthogonal ones.
+enum Direction { UP = 0, LEFT = 1, DOWN = 2, RIGHT = 3, UP_LEFT = 4, UP_RIGHT = 5, DOWN_RIGHT = 6, DOWN_LEFT = 7 };
+
+// Orthogonal parts of the diagonal move d
+inline Direction verticalPart(int d) {
+    return d < DOWN_RIGHT ? UP : DOWN;
+}
+
+inline Direction horizontalPart(int d) {
+    return d == UP_LEFT || d == DOWN_LEFT ? LEFT : RIGHT;
+}
+
+// Distance of a cell that cannot be reached
+const uint32_t UNREACHABLE = UINT32_MAX;
+
+// One bit per cell, packed into 64-bit words
+class BitGrid {
+private:
+    vector<uint64_t> words;
+
+public:
+    BitGrid(size_t cells = 0) : words((cells + 63) / 64, 0) {}
+
+    bool test(Cell c) const {
+        return (words[c >> 6] >> (c & 63)) & 1;
+    }
+
+    void set(Cell c) {
+        words[c >> 6] |= uint64_t(1) << (c & 63);
+    }
+
+    void reset(Cell c) {
+        words[c >> 6] &= ~(uint64_t(1) << (c & 63));
+    }
+
+    void clear() {
+        fill(words.begin(), words.end(), 0);
+    }
+
+    size_t wordCount() const {
+        return words.size();
+    }
+
+    uint64_t* data() {
+        return words.data();
+    }
+
+    const uint64_t* data() const {
+        return words.data();
+    }
+};
+
+// A Direction code per cell, 2 bits wide for orthogonal moves only and 4 bits
+// when diagonal moves are stored too
+class DirectionGrid {
+private:
+    vector<uint8_t> codes;
+    int shift; // log2 of the bits per cell
+    uint8_t mask;
+
+public:
+    DirectionGrid(size_t cells = 0, int bits = 2) :
+        codes((cells * bits + 7) / 8, 0),
+        shift(bits == 4 ? 2 : 1),
+        mask(uint8_t((1 << bits) - 1)) {}
+
+    Direction get(Cell c) const {
+        size_t bit = c << shift;
+        return Direction((codes[bit >> 3] >> (bit & 7)) & mask);
+    }
+
+    void set(Cell c, Direction d) {
+        size_t bit = c << shift;
+        uint8_t &byte = codes[bit >> 3];
+        byte = (byte & ~(mask << (bit & 7))) | (d << (bit & 7));
+    }
+};
+
+// One byte per cell holding the generation in which it was last marked, so
+// clearing all the marks only starts a new generation. The bytes are really
+// wiped once every 255 clears, when the generation counter wraps around.
+class StampGrid {
+private:
+    vector<uint8_t> stamps;
+    uint8_t generation;
+
+public:
+    StampGrid(size_t cells = 0) : stamps(cells, 0), generation(1) {}
+
+    bool test(Cell c) const {
+        return stamps[c] == generation;
+    }
+
+    void set(Cell c) {
+        stamps[c] = generation;
+    }
+
+    void clear() {
+        if(++generation == 0) {
+            fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+    }
+};
+
+// Read-only view of a whole file, memory-mapped where the platform allows and
+// read into memory elsewhere. Pages are mapped private, so writes through
+// data() stay in this process and never reach the file, except for a file
+// made by create, which is mapped shared (or written back when closed).
+class MappedFile {
+private:
+    char *bytes;
+    size_t length;
+    vector<char> copy;
+    string writeBack; // file to save the copy to when closed
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile() : bytes(NULL), length(0) {}
+
+    ~MappedFile() {
+        close();
+    }
+
+    // Unmaps the file, or saves the copy standing in for a created one
+    void close() {
+#ifndef _WIN32
+        if(bytes && copy.empty()) {
+            munmap(bytes, length);
+        }
+#endif
+        if(!writeBack.empty()) {
+            ofstream out(writeBack.c_str(), ios::binary);
+            out.write(copy.data(), copy.size());
+        }
+        bytes = NULL;
+        length = 0;
+        copy.clear();
+        writeBack.clear();
+    }
+
+    bool open(const string &fileName) {
+#ifndef _WIN32
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        struct stat info;
+        if(fd < 0 || fstat(fd, &info) != 0) {
+            if(fd >= 0) {
+                ::close(fd);
+            }
+            return false;
+        }
+
+        length = info.st_size;
+        void *mapped = length ? mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if(mapped != MAP_FAILED) {
+            bytes = (char *)mapped;
+            return true;
+        }
+#endif
+        ifstream in(fileName.c_str(), ios::binary);
+        copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        bytes = copy.data();
+        length = copy.size();
+        return bool(in) || in.eof();
+    }
+
+    // Creates fileName holding length zero bytes
+    bool create(const string &fileName, size_t length_) {
+        length = length_;
+#ifndef _WIN32
+        int fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if(fd < 0) {
+            return false;
+        }
+        void *mapped = length && ftruncate(fd, length) == 0 ?
+                       mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if(mapped != MAP_FAILED) {
+            bytes = (char *)mapped;
+            return true;
+        }
+#endif
+        copy.assign(length, 0);
+        bytes = copy.data();
+        writeBack = fileName;
+        return bool(ofstream(fileName.c_str(), ios::binary));
+    }
+
+    char* data() {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+// Square maze stored as a wall bitset. The grid is surrounded by a border of
+// wall cells and every row is padded to a whole number of 64-bit words, so
+// the neighbors of any open cell can be probed without bounds checks. The
+// bits live in the maze itself or in a mapped binary maze file (see
+// loadMaze), in which case opening even a huge maze costs no parsing.
+// Weighted mazes also keep the cost of entering each open cell, 1 to 9, in a
+// byte per cell; unweighted ones have no cost array at all.
 class Maze {
 private:
-    vector<vector<char> > raw;
     int size;
+    size_t stride; // cells per padded row
+    vector<uint64_t> ownWalls;
+    vector<uint8_t> ownCosts;
+    shared_ptr<MappedFile> mapping; // file holding the walls and costs, if they are not owned
+    uint64_t *walls;
+    uint8_t *costs; // NULL while every cell costs 1
+    int maxCost;
+    ptrdiff_t step[8]; // cell offset of a move in each Direction
+    uint64_t hash; // contentHash(), kept up to date by the setters once hashed
+    bool hashed;
+
+    void initSteps() {
+        step[UP] = -ptrdiff_t(stride);
+        step[LEFT] = -1;
+        step[DOWN] = stride;
+        step[RIGHT] = 1;
+        for(int d = UP_LEFT; d <= DOWN_LEFT; d++) {
+            step[d] = step[verticalPart(d)] + step[horizontalPart(d)];
+        }
+    }
+
+    bool testWall(Cell c) const {
+        return (walls[c >> 6] >> (c & 63)) & 1;
+    }
+
+    // Random 64-bit key of cell c holding a wall (value 0) or costing value,
+    // from the splitmix64 finalizer. An open cell costing 1 has no key.
+    static uint64_t cellKey(Cell c, int value) {
+        if(value == 1) {
+            return 0;
+        }
+        uint64_t x = uint64_t(c) * 16 + value + 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+public:
+    // Proxy returned by maze[i][j], reads and writes '0' (wall) or the cost
+    // '1' to '9' of an open cell
+    class CellRef {
+    private:
+        Maze &maze;
+        Cell c;
+
+    public:
+        CellRef(Maze &maze_, Cell c_) : maze(maze_), c(c_) {}
+
+        operator char() const {
+            return maze.cellChar(c);
+        }
+
+        CellRef& operator=(char value) {
+            maze.setCell(c, value);
+            return *this;
+        }
+    };
+
+    class Row {
+    private:
+        Maze &maze;
+        int i;
+
+    public:
+        Row(Maze &maze_, int i_) : maze(maze_), i(i_) {}
+
+        CellRef operator[](const int j) {
+            return CellRef(maze, maze.cell(i, j));
+        }
+    };
+
+    Maze(int N) :
+        size(N),
+        stride(paddedStride(N)),
+        ownWalls(wordCount(N), 0),
+        walls(ownWalls.data()),
+        costs(NULL),
+        maxCost(1),
+        hash(0),
+        hashed(false) {
+
+        initSteps();
+
+        // Wall off the border and the row padding
+        for(size_t r = 0; r < size_t(N) + 2; r++) {
+            for(size_t col = 0; col < stride; col++) {
+                if(r == 0 || r == size_t(N) + 1 || col == 0 || col > size_t(N)) {
+                    setWall(r * stride + col, true);
+                }
+            }
+        }
+    }
+
+    // Maze over wall words laid out as by a Maze(N) and optionally a cost
+    // byte per cell, both kept inside file
+    Maze(int N, shared_ptr<MappedFile> file, uint64_t *words, uint8_t *cellCosts, int maxCost_) :
+        size(N),
+        stride(paddedStride(N)),
+        mapping(file),
+        walls(words),
+        costs(cellCosts),
+        maxCost(maxCost_),
+        hash(0),
+        hashed(false) {
+
+        initSteps();
+    }
+
+    Maze(const Maze& other) :
+        size(other.size),
+        stride(other.stride),
+        ownWalls(other.walls, other.walls + wordCount(other.size)),
+        walls(ownWalls.data()),
+        costs(NULL),
+        maxCost(other.maxCost),
+        hash(other.hash),
+        hashed(other.hashed) {
+
+        if(other.costs) {
+            ownCosts.assign(other.costs, other.costs + other.cellCount());
+            costs = ownCosts.data();
+        }
+
+        initSteps();
+    }
+
+    Maze(Maze&& other) :
+        size(other.size),
+        stride(other.stride),
+        ownWalls(move(other.ownWalls)),
+        ownCosts(move(other.ownCosts)),
+        mapping(move(other.mapping)),
+        walls(other.walls),
+        costs(other.costs),
+        maxCost(other.maxCost),
+        hash(other.hash),
+        hashed(other.hashed) {
+
+        initSteps();
+    }
+
+    static size_t paddedStride(int N) {
+        return (N + 2 + 63) / 64 * 64;
+    }
+
+    // Number of 64-bit words holding the walls of an N x N maze
+    static size_t wordCount(int N) {
+        return (N + 2) * paddedStride(N) / 64;
+    }
+
+    bool isValidPosition(int i, int j) const {
+        return i >= 0 && j >= 0 && i < size && j < size;
+    }
+
+    bool isWall(int i, int j) const {
+        return testWall(cell(i, j));
+    }
+
+    bool isOpen(Cell c) const {
+        return !testWall(c);
+    }
+
+    // '0' for a wall, the cost '1' to '9' for an open cell
+    char cellChar(Cell c) const {
+        return isOpen(c) ? char('0' + cost(c)) : '0';
+    }
+
+    // Cost of moving into the open cell c
+    int cost(Cell c) const {
+        return costs ? costs[c] : 1;
+    }
+
+    // Upper bound of the cell costs
+    int getMaxCost() const {
+        return maxCost;
+    }
+
+    bool isWeighted() const {
+        return costs != NULL;
+    }
+
+    // Cost bytes over the padded grid, NULL for an unweighted maze
+    const uint8_t* costBytes() const {
+        return costs;
+    }
+
+    // Makes c a wall for '0', otherwise an open cell costing value - '0' (1 for
+    // anything but a digit)
+    void setCell(Cell c, char value) {
+        setWall(c, value == '0');
+        if(value != '0') {
+            setCost(c, value > '1' && value <= '9' ? value - '0' : 1);
+        }
+    }
+
+    void setCost(Cell c, int value) {
+        if(!costs && value == 1) {
+            return;
+        }
+        if(!costs) {
+            ownCosts.assign(cellCount(), 1);
+            costs = ownCosts.data();
+        }
+        if(hashed) {
+            hash ^= cellKey(c, costs[c]) ^ cellKey(c, value);
+        }
+        costs[c] = uint8_t(value);
+        maxCost = max(maxCost, value);
+    }
+
+    void setWall(Cell c, bool wall) {
+        if(hashed && testWall(c) != wall) {
+            hash ^= cellKey(c, 0);
+        }
+        if(wall) {
+            walls[c >> 6] |= uint64_t(1) << (c & 63);
+        }
+        else {
+            walls[c >> 6] &= ~(uint64_t(1) << (c & 63));
+        }
+    }
+
+    Cell cell(int i, int j) const {
+        return (i + 1) * stride + (j + 1);
+    }
+
+    Pos pos(Cell c) const {
+        return Pos(int(c / stride) - 1, int(c % stride) - 1);
+    }
+
+    Cell neighbor(Cell c, Direction d) const {
+        return c + step[d];
+    }
+
+    int getSize() const {
+        return size;
+    }
+
+    size_t getStride() const {
+        return stride;
+    }
+
+    // Wall bits of the padded grid, getStride() / 64 words per row
+    const uint64_t* wallWords() const {
+        return walls;
+    }
+
+    // Number of cells in the padded grid
+    size_t cellCount() const {
+        return (size + 2) * stride;
+    }
+
+    // FNV-1a hash of the size and the walls
+    uint64_t checksum() const {
+        uint64_t hash = 14695981039346656037ULL ^ uint64_t(size);
+        for(size_t w = 0; w < wordCount(size); w++) {
+            hash = (hash ^ walls[w]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // Zobrist hash of the size, the walls and the costs other than 1, for
+    // telling whether anything was saved for this very maze (see PathCache).
+    // The first call hashes every cell; from then on every change of a cell
+    // updates the hash in O(1).
+    uint64_t contentHash() {
+        if(!hashed) {
+            hash = cellKey(Cell(size), 15);
+            for(size_t w = 0; w < wordCount(size); w++) {
+                for(uint64_t bits = walls[w]; bits; bits &= bits - 1) {
+                    hash ^= cellKey(w * 64 + __builtin_ctzll(bits), 0);
+                }
+            }
+            for(size_t c = 0; costs && c < cellCount(); c++) {
+                hash ^= cellKey(c, costs[c]);
+            }
+            hashed = true;
+        }
+        return hash;
+    }
+
+    Row operator[](const int i) {
+        return Row(*this, i);
+    }
+
+};
+
+// Connected parts of a static maze, labeled once so that a reachability
+// question costs two lookups. Every thread runs union-find over its own block
+// of rows, joining each open cell with its open left and upper neighbors in
+// the block, then the cells on the block boundaries are joined on one thread.
+// A set's root is always its smallest cell, so no cell points forward in
+// memory and a last pass in cell order replaces every parent by its root
+// without any finds. Labels are 32-bit, enough for mazes up to about 65000
+// cells wide, and have to be rebuilt when walls change.
+class ComponentIndex {
+private:
+    const Maze &maze;
+    vector<uint32_t> parent; // the root of every cell once built
+    size_t components;
+
+    uint32_t find(uint32_t c) {
+        while(parent[c] != c) {
+            parent[c] = parent[parent[c]]; // path halving
+            c = parent[c];
+        }
+        return c;
+    }
+
+    void join(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if(a < b) {
+            parent[b] = a;
+        }
+        else if(b < a) {
+            parent[a] = b;
+        }
+    }
+
+    // Joins the open cells of rows first to last - 1 without looking outside them
+    void joinRows(int first, int last) {
+        size_t stride = maze.getStride();
+        Cell begin = maze.cell(first, 0) - 1, end = maze.cell(last, 0) - 1;
+        for(Cell c = begin; c < end; c++) {
+            parent[c] = uint32_t(c);
+        }
+
+        for(int i = first; i < last; i++) {
+            for(Cell c = maze.cell(i, 0); c <= maze.cell(i, maze.getSize() - 1); c++) {
+                if(!maze.isOpen(c)) {
+                    continue;
+                }
+                if(maze.isOpen(c - 1)) {
+                    parent[c] = uint32_t(c - 1); // c is still alone, so it can simply hang below its left neighbor
+                }
+                if(i > first && maze.isOpen(c - stride)) {
+                    join(uint32_t(c), uint32_t(c - stride));
+                }
+            }
+        }
+    }
+
+public:
+    ComponentIndex(const Maze &maze_) : maze(maze_), components(0) {}
+
+    void build(int threads = thread::hardware_concurrency()) {
+        int N = maze.getSize();
+        threads = max(1, min(threads, N));
+        int rowsPerBlock = (N + threads - 1) / threads;
+
+        parent.resize(maze.cellCount());
+        for(Cell c = 0; c < maze.cell(0, 0) - 1; c++) {
+            parent[c] = uint32_t(c);
+        }
+        for(Cell c = maze.cell(N, 0) - 1; c < maze.cellCount(); c++) {
+            parent[c] = uint32_t(c);
+        }
+
+        vector<thread> pool;
+        for(int first = 0; first < N; first += rowsPerBlock) {
+            pool.push_back(thread(&ComponentIndex::joinRows, this, first, min(N, first + rowsPerBlock)));
+        }
+        for(size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+
+        for(int i = rowsPerBlock; i < N; i += rowsPerBlock) {
+            for(Cell c = maze.cell(i, 0); c <= maze.cell(i, N - 1); c++) {
+                if(maze.isOpen(c) && maze.isOpen(c - maze.getStride())) {
+                    join(uint32_t(c), uint32_t(c - maze.getStride()));
+                }
+            }
+        }
+
+        components = 0;
+        for(Cell c = 0; c < parent.size(); c++) {
+            parent[c] = parent[parent[c]];
+            components += parent[c] == c && maze.isOpen(c);
+        }
+    }
+
+    // Number of connected parts of open cells
+    size_t count() const {
+        return components;
+    }
+
+    // Smallest cell of the part containing c, c itself for a wall
+    Cell label(Cell c) const {
+        return parent[c];
+    }
+
+    bool connected(Cell a, Cell b) const {
+        return maze.isOpen(a) && maze.isOpen(b) && parent[a] == parent[b];
+    }
+
+    bool connected(Pos a, Pos b) const {
+        return maze.isValidPosition(a.i, a.j) && maze.isValidPosition(b.i, b.j) &&
+               connected(maze.cell(a.i, a.j), maze.cell(b.i, b.j));
+    }
+
+    // A cell of the part with the most cells, 0 for a maze of walls
+    Cell largest() const {
+        unordered_map<uint32_t, size_t> cells;
+        Cell best = 0;
+        size_t bestSize = 0;
+        for(Cell c = 0; c < parent.size(); c++) {
+            if(!maze.isOpen(c)) {
+                continue;
+            }
+            size_t &n = cells[parent[c]];
+            if(++n > bestSize) {
+                best = c;
+                bestSize = n;
+            }
+        }
+        return best;
+    }
+};
+
+// Abstract class PathFinder
+class PathFinder {
+private:
+    int size;
+    int directions; // moves a cell has, 4 or 8
+    DirectionGrid prevDir; // direction of the move from the previous cell in the path (i.e. how we arrived to the current in the traverse)
+    StampGrid visited;
+    Cell source;
+    const ComponentIndex *components;
+
+protected:
+    Maze &maze;
+
+    // Starts a new query from start. The grids are reused between queries:
+    // visited marks are dropped in O(1) and previous-cell codes are only read
+    // for visited cells, so findPath may be called any number of times.
+    void beginSearch(Cell start) {
+        visited.clear();
+        source = start;
+    }
+
+    bool isVisited(Cell c) const {
+        return visited.test(c);
+    }
+
+    void markVisited(Cell c) {
+        visited.set(c);
+    }
+
+    // True when the component labels prove that target cannot be reached from
+    // start. Labels follow orthogonal moves, so they prove nothing to a search
+    // that can also move diagonally.
+    bool provenUnreachable(Cell start, Cell target) const {
+        return components && directions == 4 && this->maze.isOpen(start) && !components->connected(start, target);
+    }
+
+    // Ends an unreachable query before any search, leaving only start visited
+    bool skipSearch(Cell start, Cell target) {
+        if(!provenUnreachable(start, target)) {
+            return false;
+        }
+        markVisited(start);
+        return true;
+    }
+
+    void setPrev(Cell c, Direction d) {
+        prevDir.set(c, d);
+    }
+
+    Direction prevDirection(Cell c) const {
+        return prevDir.get(c);
+    }
+
+    Cell prevCell(Cell c) const {
+        return maze.neighbor(c, Direction(prevDir.get(c) ^ 2)); // step back against the recorded move
+    }
+
+public:    
+    virtual void findPath(Pos current, Pos target) = 0;
+
+    PathFinder(Maze &maze_, int directions_ = 4) : 
+        size(maze_.getSize()), 
+        directions(directions_),
+        prevDir(maze_.cellCount(), directions_ > 4 ? 4 : 2),
+        visited(maze_.cellCount()),
+        source(0),
+        components(NULL),
+        maze(maze_) {
+
+    }
+
+    virtual ~PathFinder() {}
+
+    // Lets queries between different parts of the maze return at once. The
+    // index must be built for the maze as it is searched.
+    void useComponents(const ComponentIndex *index) {
+        components = index;
+    }
+
+    bool isVisited(int i, int j) const {
+        return visited.test(maze.cell(i, j));
+    }
+
+    // Number of moves from the search start to end, -1 if end was not reached
+    long long pathLength(Pos end) const {
+        if(!maze.isValidPosition(end.i, end.j) || !isVisited(end.i, end.j)) {
+            return -1;
+        }
+
+        long long length = 0;
+        for(Cell c = maze.cell(end.i, end.j); c != source; c = prevCell(c)) {
+            length++;
+        }
+        return length;
+    }
+
+    // Sum of the costs of the cells entered on the way to end, -1 if end was
+    // not reached. Equals pathLength on an unweighted maze.
+    long long pathCost(Pos end) const {
+        vector<Cell> cells = pathCells(end);
+        long long cost = cells.empty() ? -1 : 0;
+        for(size_t k = 1; k < cells.size(); k++) {
+            cost += maze.cost(cells[k]);
+        }
+        return cost;
+    }
+
+    // Cells of the path to end in order from the start, empty if end was not reached
+    vector<Cell> pathCells(Pos end) const {
+        vector<Cell> cells;
+        if(!maze.isValidPosition(end.i, end.j) || !isVisited(end.i, end.j)) {
+            return cells;
+        }
+
+        Cell c = maze.cell(end.i, end.j);
+        for(; c != source; c = prevCell(c)) {
+            cells.push_back(c);
+        }
+        cells.push_back(c);
+        reverse(cells.begin(), cells.end());
+        return cells;
+    }
+
+    vector<Pos> path(Pos end) const {
+        vector<Cell> cells = pathCells(end);
+        vector<Pos> positions(cells.size());
+        for(size_t k = 0; k < cells.size(); k++) {
+            positions[k] = maze.pos(cells[k]);
+        }
+        return positions;
+    }
+
+    // Path to end as runs of moves, e.g. "D2R4D3" for two moves down, four right
+    // and three down; empty if end was not reached. Diagonal moves are written
+    // as the keys around 's' on a keyboard: 'q' up-left, 'e' up-right, 'c'
+    // down-right and 'z' down-left.
+    string pathMoves(Pos end) const {
+        vector<Cell> cells = pathCells(end);
+        string moves;
+
+        for(size_t k = 1; k < cells.size(); ) {
+            Direction d = prevDirection(cells[k]);
+            size_t run = 1;
+            while(k + run < cells.size() && prevDirection(cells[k + run]) == d) {
+                run++;
+            }
+
+            moves += "ULDRqecz"[d];
+            if(run > 1) {
+                moves += to_string(run);
+            }
+            k += run;
+        }
+        return moves;
+    }
+
+    // Prints the maze with the path to end drawn as '*'. The path is overlaid
+    // while the rows are streamed out through a large buffer, so neither the
+    // maze nor a grid of marks is copied.
+    void printPath(Pos end, ostream &out = cout) const {
+        vector<Cell> cells = pathCells(end);
+        if(cells.empty() && maze.isValidPosition(end.i, end.j)) {
+            cells.push_back(maze.cell(end.i, end.j));
+        }
+        sort(cells.begin(), cells.end());
+
+        string buffer;
+        buffer.reserve(1 << 20);
+        size_t next = 0; // first path cell not printed yet
+
+        for(int i = 0; i < size; i++) {
+            for(int j = 0; j < size; j++) {
+                Cell c = maze.cell(i, j);
+                if(next < cells.size() && cells[next] == c) {
+                    buffer += '*';
+                    next++;
+                }
+                else {
+                    buffer += maze.cellChar(c);
+                }
+                buffer += ' ';
+            }
+            buffer += '\n';
+
+            if(buffer.size() >= (1 << 20) - 2 * size_t(size) - 1) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+        out.write(buffer.data(), buffer.size());
+        out.flush();
+    }
+
+    // Writes the maze as a binary PGM image: walls black, open cells white and
+    // the path to end gray
+    bool writePathImage(Pos end, const string &fileName) const {
+        vector<Cell> cells = pathCells(end);
+        sort(cells.begin(), cells.end());
+
+        ofstream out(fileName.c_str(), ios::binary);
+        out << "P5\n" << size << " " << size << "\n255\n";
+
+        string row(size, 0);
+        size_t next = 0;
+        for(int i = 0; i < size; i++) {
+            for(int j = 0; j < size; j++) {
+                Cell c = maze.cell(i, j);
+                if(next < cells.size() && cells[next] == c) {
+                    row[j] = char(128);
+                    next++;
+                }
+                else {
+                    row[j] = maze.isOpen(c) ? char(255) : 0;
+                }
+            }
+            out.write(row.data(), size);
+        }
+        return bool(out);
+    }
+
+};
+
+// Neighborhoods of the templated engines. The moves of a cell are fixed at
+// compile time, so the loops over them are unrolled and the corner rule is
+// settled by the compiler rather than tested in the loop.
+struct FourConnected {
+    static const int directions = 4;
+
+    static bool canMove(const Maze &maze, Cell c, int d) {
+        return maze.isOpen(maze.neighbor(c, Direction(d)));
+    }
+
+    static long long moveCost(int) {
+        return 1;
+    }
+
+    // Manhattan distance, a consistent estimate for cells di rows and dj columns apart
+    static long long distance(int di, int dj) {
+        return di + dj;
+    }
+};
+
+// Which of the two cells beside a diagonal move have to be open for it
+enum CornerRule {
+    NO_CORNER_CUTTING, // both, the move may not touch a wall
+    CUT_CORNERS, // at least one, the move may clip a corner
+    SQUEEZE // none, the move may pass between two walls touching at a corner
+};
+
+template<CornerRule rule>
+struct EightConnected {
+    static const int directions = 8;
+    static const int straightCost = 70, diagonalCost = 99; // 99 / 70 is within 0.01% of the square root of 2
+
+    static bool canMove(const Maze &maze, Cell c, int d) {
+        if(!maze.isOpen(maze.neighbor(c, Direction(d)))) {
+            return false;
+        }
+        if(d < UP_LEFT || rule == SQUEEZE) {
+            return true;
+        }
+
+        bool vertical = maze.isOpen(maze.neighbor(c, verticalPart(d)));
+        bool horizontal = maze.isOpen(maze.neighbor(c, horizontalPart(d)));
+        return rule == NO_CORNER_CUTTING ? vertical && horizontal : vertical || horizontal;
+    }
+
+    // Costs are 64-bit: at 70 per move an int overflows on paths of about 30
+    // million moves, which a winding maze of 8000 x 8000 cells already has
+    static long long moveCost(int d) {
+        return d < UP_LEFT ? straightCost : diagonalCost;
+    }
+
+    // Octile distance: diagonal moves while both offsets remain, then straight ones
+    static long long distance(int di, int dj) {
+        return (long long)diagonalCost * min(di, dj) + (long long)straightCost * abs(di - dj);
+    }
+};
+
+// Depth-first search without recursion. The chain of recorded moves from the
+// current cell back to the start is exactly the recursion stack, so when a cell
+// runs out of neighbors we step back to its previous cell and resume the scan
+// after the direction we left it in. No memory beyond the PathFinder grids is
+// needed, however deep the search goes.
+template<class Neighborhood>
+class BasicDFSPathFinder : public PathFinder {
+public:
+    BasicDFSPathFinder(Maze &maze_) : PathFinder(maze_, Neighborhood::directions) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        this->markVisited(start);
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+
+        Cell current = start;
+        int d = UP; // next direction to probe from current
+
+        while(!this->isVisited(target)) { // abort if a path to the target cell is already found
+            if(d < Neighborhood::directions) {
+                Cell next = this->maze.neighbor(current, Direction(d));
+
+                if(Neighborhood::canMove(this->maze, current, d) && !this->isVisited(next)) {
+                    this->setPrev(next, Direction(d));
+                    this->markVisited(next);
+                    current = next;
+                    d = UP;
+                }
+                else {
+                    d++;
+                }
+            }
+            else {
+                if(current == start) {
+                    return; // every reachable cell is visited
+                }
+
+                d = this->prevDirection(current) + 1;
+                current = this->prevCell(current);
+            }
+        }
+    }
+};
+
+typedef BasicDFSPathFinder<FourConnected> DFSPathFinder;
+
+template<class Neighborhood>
+class BasicBFSPathFinder : public PathFinder {
+public:
+    BasicBFSPathFinder(Maze &maze_) : PathFinder(maze_, Neighborhood::directions) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        findPaths(startPos, vector<Pos>(1, targetPos));
+    }
+
+    // One search tree for several targets sharing a start, grown until all of
+    // them are visited
+    void findPaths(Pos startPos, const vector<Pos> &targetPositions) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        vector<Cell> targets;
+        for(size_t t = 0; t < targetPositions.size(); t++) {
+            Cell target = this->maze.cell(targetPositions[t].i, targetPositions[t].j);
+            if(!this->provenUnreachable(start, target)) {
+                targets.push_back(target); // no point growing the tree for the others
+            }
+        }
+        size_t pending = 0; // targets before this one are visited
+
+        this->beginSearch(start);
+        this->markVisited(start);
+
+        queue<Cell> q;
+        q.push(start);
+
+        while(!q.empty()) {
+            Cell current = q.front();
+            q.pop();
+
+            while(pending < targets.size() && this->isVisited(targets[pending])) {
+                pending++;
+            }
+            if(pending == targets.size()) {
+                return; // abort if paths to all the target cells are already found
+            }
+
+            for(int d = 0; d < Neighborhood::directions; d++) {
+                Cell next = this->maze.neighbor(current, Direction(d));
+
+                if(Neighborhood::canMove(this->maze, current, d) && !this->isVisited(next)) {
+                    this->setPrev(next, Direction(d));
+                    this->markVisited(next);
+                    q.push(next);
+                }
+            }
+        }
+    }
+};
+
+typedef BasicBFSPathFinder<FourConnected> BFSPathFinder;
+
+// Breadth-first search grown from both ends at once. Each step expands a whole
+// level of the smaller frontier, and the search stops at the first cell reached
+// from both sides. Only a level's worth of cells around each endpoint is
+// explored instead of the full disk around the start. The target side of the
+// path is copied into the previous-cell grid, so printPath works unchanged.
+class BidirectionalBFSPathFinder : public PathFinder {
+private:
+    StampGrid visitedBack; // reached by the search from the target
+    DirectionGrid nextDir; // move from a cell reached from the target towards the target
+
+    // Expands one level of the search from the start, returns the meeting cell or 0
+    Cell expandForward(vector<Cell> &frontier) {
+        vector<Cell> next;
+
+        for(size_t k = 0; k < frontier.size(); k++) {
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell c = this->maze.neighbor(frontier[k], Direction(d));
+
+                if(this->maze.isOpen(c) && !this->isVisited(c)) {
+                    this->setPrev(c, Direction(d));
+                    this->markVisited(c);
+                    if(visitedBack.test(c)) {
+                        return c;
+                    }
+                    next.push_back(c);
+                }
+            }
+        }
+
+        frontier.swap(next);
+        return 0;
+    }
+
+    // Expands one level of the search from the target, returns the meeting cell or 0
+    Cell expandBackward(vector<Cell> &frontier) {
+        vector<Cell> next;
+
+        for(size_t k = 0; k < frontier.size(); k++) {
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell c = this->maze.neighbor(frontier[k], Direction(d));
+
+                if(this->maze.isOpen(c) && !visitedBack.test(c)) {
+                    nextDir.set(c, Direction(d ^ 2));
+                    visitedBack.set(c);
+                    if(this->isVisited(c)) {
+                        return c;
+                    }
+                    next.push_back(c);
+                }
+            }
+        }
+
+        frontier.swap(next);
+        return 0;
+    }
+
+public:
+    BidirectionalBFSPathFinder(Maze &maze_) :
+        PathFinder(maze_),
+        visitedBack(maze_.cellCount()),
+        nextDir(maze_.cellCount()) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        this->markVisited(start);
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+        visitedBack.clear();
+        visitedBack.set(target);
+
+        Cell meet = start == target ? start : 0;
+        vector<Cell> forward(1, start), backward;
+        if(this->maze.isOpen(target)) {
+            backward.push_back(target);
+        }
+
+        // The first meeting cell is on a shortest path: a cell reached earlier
+        // from the other side would have been met one level sooner
+        while(!meet && !forward.empty() && !backward.empty()) {
+            meet = forward.size() <= backward.size() ? expandForward(forward) : expandBackward(backward);
+        }
+
+        // Record the second half of the path as moves from the start side
+        for(Cell c = meet; meet && c != target; ) {
+            Direction d = nextDir.get(c);
+            c = this->maze.neighbor(c, d);
+            this->setPrev(c, d);
+            this->markVisited(c);
+        }
+    }
+};
+
+// Breadth-first search over whole words of the grid. The frontier and the
+// reached set are bitsets with the layout of the maze walls, so a level is
+// expanded 64 cells at a time with shifts and masks. Only the words next to
+// non-empty frontier words are computed, so sparse frontiers cost no more than
+// a queue while wide open fronts are processed a word at a time. Instead of a
+// previous cell, each reached cell stores its distance modulo 3 in two bit
+// planes: neighbors differ in distance by at most one, which is enough to walk
+// back from the target along decreasing distances. Only the cells of that
+// path are marked visited in the PathFinder.
+class BitParallelBFSPathFinder : public PathFinder {
+private:
+    size_t rowWords, firstWord, lastWord; // words of the maze rows, border rows excluded
+    BitGrid reached, frontier, next;
+    BitGrid layerLow, layerHigh; // distance % 3 of each reached cell
+    vector<size_t> active, candidates; // non-empty frontier words, words to compute
+    vector<uint8_t> isCandidate;
+    vector<size_t> touched; // words written by the last query
+
+    // Zeroes the words the last query wrote, in time proportional to its work
+    void clearTouched() {
+        for(size_t k = 0; k < touched.size(); k++) {
+            size_t w = touched[k];
+            reached.data()[w] = frontier.data()[w] = 0;
+            layerLow.data()[w] = layerHigh.data()[w] = 0;
+        }
+        touched.clear();
+    }
+
+    int layer(Cell c) const {
+        return layerLow.test(c) | (layerHigh.test(c) << 1);
+    }
+
+    void addCandidate(size_t w) {
+        if(w >= firstWord && w < lastWord && !isCandidate[w]) {
+            isCandidate[w] = 1;
+            candidates.push_back(w);
+        }
+    }
+
+    // Moves the frontier one level further, returns false if it is empty
+    bool expand(int distance) {
+        const uint64_t *walls = this->maze.wallWords();
+        uint64_t *f = frontier.data(), *n = next.data(), *v = reached.data();
+        uint64_t *low = layerLow.data(), *high = layerHigh.data();
+        uint64_t lowMask = distance % 3 & 1 ? ~uint64_t(0) : 0;
+        uint64_t highMask = distance % 3 & 2 ? ~uint64_t(0) : 0;
+
+        candidates.clear();
+        for(size_t k = 0; k < active.size(); k++) {
+            size_t w = active[k];
+            addCandidate(w - rowWords);
+            addCandidate(w);
+            addCandidate(w + rowWords);
+            if(f[w] & 1) {
+                addCandidate(w - 1);
+            }
+            if(f[w] >> 63) {
+                addCandidate(w + 1);
+            }
+        }
+
+        vector<size_t> reachedWords;
+        for(size_t k = 0; k < candidates.size(); k++) {
+            size_t w = candidates[k];
+            isCandidate[w] = 0;
+
+            uint64_t reach = (f[w] << 1) | (f[w - 1] >> 63) | (f[w] >> 1) | (f[w + 1] << 63) |
+                             f[w - rowWords] | f[w + rowWords];
+            reach &= ~walls[w] & ~v[w];
+
+            if(reach) {
+                n[w] = reach;
+                v[w] |= reach;
+                low[w] |= reach & lowMask;
+                high[w] |= reach & highMask;
+                reachedWords.push_back(w);
+            }
+        }
+
+        for(size_t k = 0; k < active.size(); k++) {
+            f[active[k]] = 0;
+        }
+        touched.insert(touched.end(), reachedWords.begin(), reachedWords.end());
+        swap(frontier, next);
+        active.swap(reachedWords);
+        return !active.empty();
+    }
+
+public:
+    BitParallelBFSPathFinder(Maze &maze_) :
+        PathFinder(maze_),
+        rowWords(maze_.getStride() / 64),
+        firstWord(rowWords),
+        lastWord((maze_.getSize() + 1) * rowWords),
+        reached(maze_.cellCount()),
+        frontier(maze_.cellCount()),
+        next(maze_.cellCount()),
+        layerLow(maze_.cellCount()),
+        layerHigh(maze_.cellCount()),
+        isCandidate(lastWord, 0) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        this->markVisited(start);
+        clearTouched();
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+        reached.set(start);
+        frontier.set(start);
+        active.assign(1, start / 64);
+        touched.push_back(start / 64);
+
+        int distance = 0;
+
+        while(!reached.test(target)) {
+            if(!expand(++distance)) {
+                return; // the target cannot be reached
+            }
+        }
+
+        // Walk back from the target through neighbors one layer closer to the start
+        for(Cell c = target; c != start; distance--) {
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell prev = this->maze.neighbor(c, Direction(d));
+
+                if(reached.test(prev) && layer(prev) == (distance + 2) % 3) {
+                    this->setPrev(c, Direction(d ^ 2));
+                    this->markVisited(c);
+                    c = prev;
+                    break;
+                }
+            }
+        }
+    }
+};
+
+// Open list entry of the best-first searches. A cell may be queued several
+// times; only its first, cheapest, removal from the queue counts.
+struct SearchNode {
+    long long f, g; // estimated total and exact cost from the start
+    Cell cell;
+    Cell from; // cell the entry was generated from
+    int dir; // Direction of the last move into cell, -1 for the start
+
+    SearchNode(long long f_, long long g_, Cell cell_, Cell from_, int dir_) :
+        f(f_), g(g_), cell(cell_), from(from_), dir(dir_) {}
+
+    // Lowest f on top of a priority_queue, ties broken towards the deeper node
+    bool operator<(const SearchNode& o) const {
+        return f != o.f ? f > o.f : g < o.g;
+    }
+};
+
+// A* with the distance of the neighborhood: Manhattan on a 4-connected grid
+// with unit moves, octile with straight and diagonal move costs on an
+// 8-connected one. Both are consistent, so a cell is final the first time it
+// leaves the queue.
+template<class Neighborhood>
+class BasicAStarPathFinder : public PathFinder {
+protected:
+    Pos goal;
+
+    long long heuristic(Cell c) const {
+        Pos p = this->maze.pos(c);
+        return Neighborhood::distance(abs(p.i - goal.i), abs(p.j - goal.j));
+    }
+
+public:
+    BasicAStarPathFinder(Maze &maze_) : PathFinder(maze_, Neighborhood::directions) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+        goal = targetPos;
+
+        priority_queue<SearchNode> open;
+        open.push(SearchNode(heuristic(start), 0, start, start, -1));
+
+        while(!open.empty()) {
+            SearchNode current = open.top();
+            open.pop();
+
+            if(this->isVisited(current.cell)) {
+                continue;
+            }
+            this->markVisited(current.cell);
+            if(current.dir >= 0) {
+                this->setPrev(current.cell, Direction(current.dir));
+            }
+
+            if(current.cell == target) {
+                return;
+            }
+
+            for(int d = 0; d < Neighborhood::directions; d++) {
+                Cell next = this->maze.neighbor(current.cell, Direction(d));
+
+                if(Neighborhood::canMove(this->maze, current.cell, d) && !this->isVisited(next)) {
+                    long long g = current.g + Neighborhood::moveCost(d);
+                    open.push(SearchNode(g + heuristic(next), g, next, current.cell, d));
+                }
+            }
+        }
+    }
+};
+
+typedef BasicAStarPathFinder<FourConnected> AStarPathFinder;
+
+// Jump Point Search adapted to 4-connected grids. Of all shortest paths only
+// the canonical ones are followed: vertical runs that may branch off
+// horizontally at any cell, and horizontal runs that turn vertical only where
+// a wall behind them forces it. Runs are scanned without queueing their cells,
+// and only the jump points where a canonical path can turn enter the open list.
+class JumpPointPathFinder : public AStarPathFinder {
+private:
+    Cell target;
+
+    bool isOpen(Cell c, Direction d) const {
+        return this->maze.isOpen(this->maze.neighbor(c, d));
+    }
+
+    // A cell on a horizontal run has to turn vertical if the cell behind it
+    // cannot reach the same vertical neighbor
+    bool isForced(Cell c, Direction horizontal, Direction vertical) const {
+        return isOpen(c, vertical) && !isOpen(this->maze.neighbor(c, Direction(horizontal ^ 2)), vertical);
+    }
+
+    // First jump point of the run from c in a horizontal direction, 0 if none
+    Cell jumpHorizontal(Cell c, Direction d) const {
+        for(;;) {
+            c = this->maze.neighbor(c, d);
+
+            if(!this->maze.isOpen(c)) {
+                return 0;
+            }
+            if(c == target || isForced(c, d, UP) || isForced(c, d, DOWN)) {
+                return c;
+            }
+        }
+    }
+
+    // First jump point of the run from c in a vertical direction, 0 if none
+    Cell jumpVertical(Cell c, Direction d) const {
+        for(;;) {
+            c = this->maze.neighbor(c, d);
+
+            if(!this->maze.isOpen(c)) {
+                return 0;
+            }
+            if(c == target || jumpHorizontal(c, LEFT) || jumpHorizontal(c, RIGHT)) {
+                return c;
+            }
+        }
+    }
+
+    void push(priority_queue<SearchNode> &open, const SearchNode &from, Cell jumpPoint, Direction d) {
+        if(jumpPoint && !this->isVisited(jumpPoint)) {
+            Pos a = this->maze.pos(from.cell), b = this->maze.pos(jumpPoint);
+            long long g = from.g + abs(a.i - b.i) + abs(a.j - b.j);
+            open.push(SearchNode(g + heuristic(jumpPoint), g, jumpPoint, from.cell, d));
+        }
+    }
+
+public:
+    JumpPointPathFinder(Maze &maze_) : AStarPathFinder(maze_) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+        goal = targetPos;
+
+        unordered_map<Cell, SearchNode> closed; // jump points by cell, to rebuild the path
+        priority_queue<SearchNode> open;
+        open.push(SearchNode(heuristic(start), 0, start, start, -1));
+
+        while(!open.empty()) {
+            SearchNode current = open.top();
+            open.pop();
+
+            if(this->isVisited(current.cell)) {
+                continue;
+            }
+            this->markVisited(current.cell);
+            closed.insert(make_pair(current.cell, current));
+
+            if(current.cell == target) {
+                break;
+            }
+
+            int d = current.dir;
+            if(d < 0 || d == UP || d == DOWN) {
+                if(d < 0) {
+                    push(open, current, jumpVertical(current.cell, UP), UP);
+                    push(open, current, jumpVertical(current.cell, DOWN), DOWN);
+                }
+                else {
+                    push(open, current, jumpVertical(current.cell, Direction(d)), Direction(d));
+                }
+                push(open, current, jumpHorizontal(current.cell, LEFT), LEFT);
+                push(open, current, jumpHorizontal(current.cell, RIGHT), RIGHT);
+            }
+            else {
+                push(open, current, jumpHorizontal(current.cell, Direction(d)), Direction(d));
+                for(int v = UP; v <= DOWN; v += DOWN - UP) {
+                    if(isForced(current.cell, Direction(d), Direction(v))) {
+                        push(open, current, jumpVertical(current.cell, Direction(v)), Direction(v));
+                    }
+                }
+            }
+        }
+
+        if(!this->isVisited(target)) {
+            return;
+        }
+
+        // Fill in the cells of the straight runs between consecutive jump points
+        for(Cell c = target; c != start; ) {
+            const SearchNode &node = closed.find(c)->second;
+            for(; c != node.from; c = this->maze.neighbor(c, Direction(node.dir ^ 2))) {
+                this->setPrev(c, Direction(node.dir));
+                this->markVisited(c);
+            }
+        }
+    }
+};
+
+// Dijkstra's algorithm for weighted mazes with Dial's bucket queue. Cell
+// costs are small integers, so the tentative distances still queued always
+// lie within getMaxCost() of the current one, and a ring of getMaxCost() + 1
+// buckets replaces the heap. Like A*, a cell may be queued more than once and
+// is final the first time it leaves the queue.
+class DijkstraPathFinder : public PathFinder {
+private:
+    struct Entry {
+        Cell cell;
+        int dir; // Direction of the last move into cell, -1 for the start
+    };
+
+    vector<vector<Entry> > buckets;
+
+public:
+    DijkstraPathFinder(Maze &maze_) : PathFinder(maze_) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        if(this->skipSearch(start, target)) {
+            return;
+        }
+
+        size_t ring = this->maze.getMaxCost() + 1;
+        buckets.assign(ring, vector<Entry>());
+        Entry first = { start, -1 };
+        buckets[0].push_back(first);
+        size_t queued = 1;
+
+        for(size_t distance = 0; queued > 0; distance++) {
+            vector<Entry> &bucket = buckets[distance % ring];
+
+            while(!bucket.empty()) {
+                Entry current = bucket.back();
+                bucket.pop_back();
+                queued--;
+
+                if(this->isVisited(current.cell)) {
+                    continue;
+                }
+                this->markVisited(current.cell);
+                if(current.dir >= 0) {
+                    this->setPrev(current.cell, Direction(current.dir));
+                }
+
+                if(current.cell == target) {
+                    return;
+                }
+
+                for(int d = UP; d <= RIGHT; d++) {
+                    Cell next = this->maze.neighbor(current.cell, Direction(d));
+
+                    if(this->maze.isOpen(next) && !this->isVisited(next)) {
+                        Entry entry = { next, d };
+                        buckets[(distance + this->maze.cost(next)) % ring].push_back(entry);
+                        queued++;
+                    }
+                }
+            }
+        }
+    }
+};
+
+// D* Lite incremental planner. The search runs backwards from the target and
+// keeps, for every cell, g (its settled cost to the target) and rhs (the
+// one-step lookahead from its neighbors). When walls change or the start
+// moves, only the cells whose costs are affected become inconsistent and are
+// repaired, instead of searching the whole maze again. Calling findPath with
+// the same target again reuses the previous search tree; setWall and moveTo
+// report changes between calls. Costs follow the weights of the maze.
+class DStarLitePathFinder : public PathFinder {
+private:
+    typedef pair<long long, long long> Key;
+
+    struct Entry {
+        Key key;
+        Cell cell;
+
+        bool operator<(const Entry& o) const {
+            return key > o.key; // smallest key on top
+        }
+    };
+
+    vector<uint32_t> g, rhs;
+    priority_queue<Entry> open; // may hold outdated entries, checked when popped
+    Cell start, goal;
+    long long km; // heuristic offset accumulated by the moves of the start
+    size_t expanded;
+    bool planned;
+
+    long long heuristic(Cell a, Cell b) const {
+        Pos p = this->maze.pos(a), q = this->maze.pos(b);
+        return abs(p.i - q.i) + abs(p.j - q.j);
+    }
+
+    Key calculateKey(Cell c) const {
+        long long best = min(g[c], rhs[c]);
+        if(best == UNREACHABLE) {
+            return Key(LLONG_MAX, LLONG_MAX);
+        }
+        return Key(best + heuristic(start, c) + km, best);
+    }
+
+    // Cheapest cost to the target through one of the neighbors of c
+    uint32_t lookahead(Cell c) const {
+        if(!this->maze.isOpen(c)) {
+            return UNREACHABLE;
+        }
+
+        uint32_t best = UNREACHABLE;
+        for(int d = UP; d <= RIGHT; d++) {
+            Cell next = this->maze.neighbor(c, Direction(d));
+            if(this->maze.isOpen(next) && g[next] != UNREACHABLE) {
+                best = min(best, uint32_t(g[next] + this->maze.cost(next)));
+            }
+        }
+        return best;
+    }
+
+    // The target itself costs 0 to reach while it is open, so its rhs follows
+    // its wall as the others follow their neighbors
+    void updateVertex(Cell c) {
+        if(c == goal) {
+            rhs[c] = this->maze.isOpen(c) ? 0 : UNREACHABLE;
+        }
+        else {
+            rhs[c] = lookahead(c);
+        }
+        if(g[c] != rhs[c]) {
+            Entry entry = { calculateKey(c), c };
+            open.push(entry);
+        }
+    }
+
+    void updateNeighbors(Cell c) {
+        for(int d = UP; d <= RIGHT; d++) {
+            Cell next = this->maze.neighbor(c, Direction(d));
+            if(this->maze.isOpen(next)) {
+                updateVertex(next);
+            }
+        }
+    }
+
+    // Drops queue entries of cells that have become consistent
+    void skipConsistent() {
+        while(!open.empty() && g[open.top().cell] == rhs[open.top().cell]) {
+            open.pop();
+        }
+    }
+
+    void computeShortestPath() {
+        expanded = 0;
+        skipConsistent();
+
+        while(!open.empty() && (open.top().key < calculateKey(start) || rhs[start] != g[start])) {
+            Entry top = open.top();
+            open.pop();
+            Cell c = top.cell;
+            Key key = calculateKey(c);
+
+            if(top.key < key) {
+                Entry entry = { key, c };
+                open.push(entry);
+            }
+            else if(g[c] > rhs[c]) {
+                g[c] = rhs[c];
+                expanded++;
+                updateNeighbors(c);
+            }
+            else {
+                g[c] = UNREACHABLE;
+                expanded++;
+                updateVertex(c);
+                updateNeighbors(c);
+            }
+            skipConsistent();
+        }
+    }
+
+    void initialize(Cell newStart, Cell newGoal) {
+        fill(g.begin(), g.end(), UNREACHABLE);
+        fill(rhs.begin(), rhs.end(), UNREACHABLE);
+        open = priority_queue<Entry>();
+        start = newStart;
+        goal = newGoal;
+        km = 0;
+        planned = true;
+
+        updateVertex(goal);
+    }
+
+    // Records the path from start by always stepping to the neighbor closest to the target
+    void extractPath() {
+        this->beginSearch(start);
+        this->markVisited(start);
+
+        if(g[start] == UNREACHABLE) {
+            return;
+        }
+
+        for(Cell c = start; c != goal; ) {
+            int bestDir = -1;
+            uint32_t best = UNREACHABLE;
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell next = this->maze.neighbor(c, Direction(d));
+                if(this->maze.isOpen(next) && g[next] != UNREACHABLE && g[next] + this->maze.cost(next) < best) {
+                    best = g[next] + this->maze.cost(next);
+                    bestDir = d;
+                }
+            }
+
+            c = this->maze.neighbor(c, Direction(bestDir));
+            this->setPrev(c, Direction(bestDir));
+            this->markVisited(c);
+        }
+    }
+
+public:
+    DStarLitePathFinder(Maze &maze_) :
+        PathFinder(maze_),
+        g(maze_.cellCount(), UNREACHABLE),
+        rhs(maze_.cellCount(), UNREACHABLE),
+        start(0),
+        goal(0),
+        km(0),
+        expanded(0),
+        planned(false) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell newStart = this->maze.cell(startPos.i, startPos.j);
+        Cell newGoal = this->maze.cell(targetPos.i, targetPos.j);
+
+        if(!planned || newGoal != goal) {
+            initialize(newStart, newGoal);
+        }
+        else if(newStart != start) {
+            moveTo(startPos);
+        }
+
+        computeShortestPath();
+        extractPath();
+    }
+
+    // The agent now stands at p; the next findPath plans from there
+    void moveTo(Pos p) {
+        Cell c = this->maze.cell(p.i, p.j);
+        km += heuristic(start, c);
+        start = c;
+    }
+
+    // Adds or removes a wall and marks the cells whose costs it affects
+    void setWall(Pos p, bool wall) {
+        Cell c = this->maze.cell(p.i, p.j);
+        if(this->maze.isOpen(c) != wall) {
+            return;
+        }
+
+        this->maze.setWall(c, wall);
+        if(planned) {
+            if(wall) {
+                g[c] = UNREACHABLE;
+            }
+            updateVertex(c);
+            updateNeighbors(c);
+        }
+    }
+
+    // Cells expanded by the last findPath
+    size_t expansions() const {
+        return expanded;
+    }
+};
+
+// Blocks the calling threads until all of them have arrived
+class Barrier {
+private:
+    mutex lock;
+    condition_variable arrived;
+    int threads, waiting, generation;
+
+public:
+    Barrier(int threads_) : threads(threads_), waiting(0), generation(0) {}
+
+    void wait() {
+        unique_lock<mutex> guard(lock);
+        int current = generation;
+
+        if(++waiting == threads) {
+            waiting = 0;
+            generation++;
+            arrived.notify_all();
+        }
+        else {
+            arrived.wait(guard, [&] { return generation != current; });
+        }
+    }
+};
+
+// Level-synchronous BFS on several threads. The maze rows are split into one
+// block per thread and each thread owns the visited bits, previous-cell codes
+// and frontier of its block, so cells are marked without atomics. A neighbor
+// across a block boundary is handed to the owning thread, which claims it after
+// the level's first barrier. Paths are as short as with BFSPathFinder but ties
+// between equally short paths may be broken differently.
+class ParallelBFSPathFinder : public PathFinder {
+private:
+    int threads;
+    int rowsPerBlock;
+    vector<vector<Cell> > frontier, next;
+    vector<vector<vector<pair<Cell, int> > > > outbox; // [from][to] cells found in another block
+    vector<char> busy; // thread found cells in the last level
+    bool found;
+
+    int owner(Cell c) const {
+        return (this->maze.pos(c).i) / rowsPerBlock;
+    }
+
+    void claim(int t, Cell c, int d) {
+        this->setPrev(c, Direction(d));
+        this->markVisited(c);
+        next[t].push_back(c);
+    }
+
+    void worker(int t, Cell target, Barrier &barrier) {
+        Cell first = this->maze.cell(t * rowsPerBlock, 0) - 1;
+        Cell last = this->maze.cell(min((t + 1) * rowsPerBlock, this->maze.getSize()), 0) - 1;
+
+        for(;;) {
+            for(size_t k = 0; k < frontier[t].size(); k++) {
+                for(int d = UP; d <= RIGHT; d++) {
+                    Cell c = this->maze.neighbor(frontier[t][k], Direction(d));
+
+                    if(this->maze.isOpen(c)) {
+                        if(c < first || c >= last) {
+                            outbox[t][owner(c)].push_back(make_pair(c, d));
+                        }
+                        else if(!this->isVisited(c)) {
+                            claim(t, c, d);
+                        }
+                    }
+                }
+            }
+            barrier.wait();
+
+            for(int from = 0; from < threads; from++) {
+                vector<pair<Cell, int> > &cells = outbox[from][t];
+                for(size_t k = 0; k < cells.size(); k++) {
+                    if(!this->isVisited(cells[k].first)) {
+                        claim(t, cells[k].first, cells[k].second);
+                    }
+                }
+                cells.clear();
+            }
+
+            frontier[t].swap(next[t]);
+            next[t].clear();
+            busy[t] = !frontier[t].empty();
+            if(target >= first && target < last && this->isVisited(target)) {
+                found = true;
+            }
+            barrier.wait();
+
+            if(found || count(busy.begin(), busy.end(), 1) == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    ParallelBFSPathFinder(Maze &maze_, int threads_ = thread::hardware_concurrency()) :
+        PathFinder(maze_),
+        threads(max(1, min(threads_, maze_.getSize()))),
+        rowsPerBlock((maze_.getSize() + threads - 1) / threads),
+        frontier(threads),
+        next(threads),
+        outbox(threads, vector<vector<pair<Cell, int> > >(threads)),
+        busy(threads, 0),
+        found(false) {}
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        this->markVisited(start);
+        found = start == target;
+        if(found || this->skipSearch(start, target)) {
+            return;
+        }
+
+        frontier[owner(start)].push_back(start);
+
+        Barrier barrier(threads);
+        vector<thread> pool;
+        for(int t = 1; t < threads; t++) {
+            pool.push_back(thread(&ParallelBFSPathFinder::worker, this, t, target, ref(barrier)));
+        }
+        worker(0, target, barrier);
+
+        for(size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+        for(int t = 0; t < threads; t++) {
+            frontier[t].clear();
+        }
+    }
+};
+
+// Hierarchical path-finding A* (HPA*) for very large mazes. The maze is cut
+// into square tiles and the open cells facing each other across a tile border
+// become entrances: the middle of a short run of openings, both ends of a long
+// one. The abstract graph links the two sides of every entrance with one move
+// and the entrances of each tile with their distance inside the tile, found
+// once by a BFS confined to the tile. A query links start and target into
+// that graph, runs A* over its few nodes and turns every abstract edge back
+// into cells with another tile-bound BFS. Every run of openings has an
+// entrance, so a target is found whenever it is reachable, but the path may
+// be a few percent longer than the shortest. Start and target have to be open
+// cells. Small tiles keep the preprocessing cheap on mazes with many openings.
+// The graph holds for the maze it was built on: the first query after any
+// cell changes builds it again, which costs as much as the first build.
+class HierarchicalPathFinder : public PathFinder {
+private:
+    struct Edge {
+        int to;
+        uint32_t cost;
+    };
+
+    // A BFS inside one tile. The tile is copied with a ring of walls around it,
+    // so the search runs on small local indices without any bounds checks.
+    struct TileSearch {
+        vector<uint8_t> open, wanted;
+        vector<uint32_t> dist;
+        vector<uint8_t> dir;
+        vector<int> queue;
+    };
+
+    int tileSize, tiles; // tiles per side
+    vector<Cell> nodeCell;
+    vector<vector<Edge> > edges;
+    vector<vector<int> > tileNodes;
+    bool built;
+    uint64_t builtHash; // Maze::contentHash of the maze the graph was built on
+    int builtThreads;
+    TileSearch scratch;
+    vector<uint32_t> g;
+    vector<int> parent;
+
+    int tileOf(Cell c) const {
+        Pos p = this->maze.pos(c);
+        return p.i / tileSize * tiles + p.j / tileSize;
+    }
+
+    // Index of c in the copy of its tile
+    int local(Cell c) const {
+        Pos p = this->maze.pos(c);
+        return (p.i % tileSize + 1) * (tileSize + 2) + p.j % tileSize + 1;
+    }
+
+    void loadTile(int tile, TileSearch &search) const {
+        int width = tileSize + 2;
+        int top = tile / tiles * tileSize, left = tile % tiles * tileSize;
+        int bottom = min(top + tileSize, this->maze.getSize()), right = min(left + tileSize, this->maze.getSize());
+
+        search.open.assign(width * width, 0);
+        search.wanted.assign(width * width, 0);
+        for(int i = top; i < bottom; i++) {
+            for(int j = left; j < right; j++) {
+                search.open[(i - top + 1) * width + j - left + 1] = !this->maze.isWall(i, j);
+            }
+        }
+    }
+
+    // BFS from the local cell source over the loaded tile, stopping once the
+    // wanted cells have all been reached
+    void searchTile(int source, TileSearch &search, int wanted) const {
+        int width = tileSize + 2;
+        int step[4] = { -width, -1, width, 1 };
+        search.dist.assign(width * width, UNREACHABLE);
+        search.dir.resize(width * width);
+        search.queue.assign(1, source);
+        search.dist[source] = 0;
+        wanted -= search.wanted[source];
+
+        for(size_t k = 0; k < search.queue.size() && wanted > 0; k++) {
+            int current = search.queue[k];
+            uint32_t distance = search.dist[current] + 1;
+
+            for(int d = UP; d <= RIGHT; d++) {
+                int next = current + step[d];
+                if(search.open[next] && search.dist[next] == UNREACHABLE) {
+                    search.dist[next] = distance;
+                    search.dir[next] = uint8_t(d);
+                    search.queue.push_back(next);
+                    wanted -= search.wanted[next];
+                }
+            }
+        }
+    }
+
+    // Node of the cell c, added to the graph unless c is already an entrance of another border
+    int node(Cell c) {
+        vector<int> &members = tileNodes[tileOf(c)];
+        for(size_t k = 0; k < members.size(); k++) {
+            if(nodeCell[members[k]] == c) {
+                return members[k];
+            }
+        }
+
+        int n = int(nodeCell.size());
+        nodeCell.push_back(c);
+        edges.push_back(vector<Edge>());
+        members.push_back(n);
+        return n;
+    }
+
+    void addEntrance(Cell a, Cell b) {
+        int na = node(a), nb = node(b);
+        Edge ab = { nb, 1 }, ba = { na, 1 };
+        edges[na].push_back(ab);
+        edges[nb].push_back(ba);
+    }
+
+    // Entrances along count cells from first, each facing the cell across at
+    // offset, moving by along between consecutive cells
+    void addEntrances(Cell first, size_t offset, size_t along, int count) {
+        for(int k = 0; k < count; ) {
+            Cell c = first + k * along;
+            if(!this->maze.isOpen(c) || !this->maze.isOpen(c + offset)) {
+                k++;
+                continue;
+            }
+
+            int run = 1;
+            while(k + run < count && this->maze.isOpen(c + run * along) && this->maze.isOpen(c + run * along + offset)) {
+                run++;
+            }
+
+            if(run < 6) {
+                Cell middle = c + run / 2 * along;
+                addEntrance(middle, middle + offset);
+            }
+            else {
+                Cell last = c + (run - 1) * along;
+                addEntrance(c, c + offset);
+                addEntrance(last, last + offset);
+            }
+            k += run;
+        }
+    }
+
+    // Links every node of the tile to the others it reaches inside the tile.
+    // Distances are symmetric, so each search only has to reach the nodes
+    // after its source.
+    void linkTile(int tile, TileSearch &search) {
+        const vector<int> &members = tileNodes[tile];
+        if(members.size() < 2) {
+            return;
+        }
+
+        loadTile(tile, search);
+        vector<int> cells(members.size());
+        for(size_t a = 0; a < members.size(); a++) {
+            cells[a] = local(nodeCell[members[a]]);
+            search.wanted[cells[a]] = 1;
+        }
+
+        for(size_t a = 0; a + 1 < members.size(); a++) {
+            search.wanted[cells[a]] = 0;
+            searchTile(cells[a], search, int(members.size() - a - 1));
+            for(size_t b = a + 1; b < members.size(); b++) {
+                uint32_t distance = search.dist[cells[b]];
+                if(distance != UNREACHABLE) {
+                    Edge ab = { members[b], distance }, ba = { members[a], distance };
+                    edges[members[a]].push_back(ab);
+                    edges[members[b]].push_back(ba);
+                }
+            }
+        }
+    }
+
+    // Distance inside its tile from the cell source to every cell of the tile
+    void searchFrom(Cell source) {
+        loadTile(tileOf(source), scratch);
+        searchTile(local(source), scratch, INT_MAX);
+    }
+
+    // Appends the cells after from on the shortest way to to inside their tile
+    void appendTilePath(Cell from, Cell to, vector<Cell> &cells) {
+        loadTile(tileOf(from), scratch);
+        scratch.wanted[local(to)] = 1;
+        searchTile(local(from), scratch, 1);
+
+        size_t first = cells.size();
+        for(Cell c = to; c != from; c = this->maze.neighbor(c, Direction(scratch.dir[local(c)] ^ 2))) {
+            cells.push_back(c);
+        }
+        reverse(cells.begin() + first, cells.end());
+    }
+
+    int manhattan(Cell a, Cell b) const {
+        Pos p = this->maze.pos(a), q = this->maze.pos(b);
+        return abs(p.i - q.i) + abs(p.j - q.j);
+    }
+
+    // A* over the abstract graph from node s to node t, leaving the parent of every reached node
+    bool searchAbstract(int s, int t) {
+        g.assign(nodeCell.size(), UNREACHABLE);
+        parent.assign(nodeCell.size(), -1);
+        g[s] = 0;
+
+        priority_queue<pair<long long, int>, vector<pair<long long, int> >, greater<pair<long long, int> > > open;
+        open.push(make_pair(manhattan(nodeCell[s], nodeCell[t]), s));
+        while(!open.empty()) {
+            int u = open.top().second;
+            long long f = open.top().first;
+            open.pop();
+
+            if(u == t) {
+                return true;
+            }
+            if(f != g[u] + manhattan(nodeCell[u], nodeCell[t])) {
+                continue; // stale entry
+            }
+
+            for(size_t k = 0; k < edges[u].size(); k++) {
+                const Edge &e = edges[u][k];
+                if(g[u] + e.cost < g[e.to]) {
+                    g[e.to] = g[u] + e.cost;
+                    parent[e.to] = u;
+                    open.push(make_pair(g[e.to] + manhattan(nodeCell[e.to], nodeCell[t]), e.to));
+                }
+            }
+        }
+        return false;
+    }
+
+public:
+    HierarchicalPathFinder(Maze &maze_, int tileSize_ = 16) :
+        PathFinder(maze_),
+        tileSize(max(2, tileSize_)),
+        tiles((maze_.getSize() + tileSize - 1) / tileSize),
+        built(false),
+        builtHash(0),
+        builtThreads(max(1, int(thread::hardware_concurrency()))) {}
+
+    // Finds the entrances on one thread, then the distances inside the tiles on the given number of threads
+    void build(int threads = thread::hardware_concurrency()) {
+        int N = this->maze.getSize();
+        nodeCell.clear();
+        edges.clear();
+        tileNodes.assign(tiles * tiles, vector<int>());
+        builtHash = this->maze.contentHash();
+        builtThreads = threads;
+
+        for(int ti = 0; ti < tiles; ti++) {
+            int top = ti * tileSize, height = min(N - top, tileSize);
+            for(int tj = 0; tj < tiles; tj++) {
+                int left = tj * tileSize, width = min(N - left, tileSize);
+                if(left + width < N) {
+                    addEntrances(this->maze.cell(top, left + width - 1), 1, this->maze.getStride(), height);
+                }
+                if(top + height < N) {
+                    addEntrances(this->maze.cell(top + height - 1, left), this->maze.getStride(), 1, width);
+                }
+            }
+        }
+
+        // Every thread only adds edges to the nodes of the tiles it takes
+        atomic<int> nextTile(0);
+        auto worker = [&]() {
+            TileSearch search;
+            for(int tile = nextTile++; tile < tiles * tiles; tile = nextTile++) {
+                linkTile(tile, search);
+            }
+        };
+        vector<thread> pool;
+        for(int t = 1; t < threads; t++) {
+            pool.push_back(thread(worker));
+        }
+        worker();
+        for(size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+        built = true;
+    }
+
+    // Nodes of the abstract graph
+    size_t nodeCount() const {
+        return nodeCell.size();
+    }
+
+    virtual void findPath(Pos startPos, Pos targetPos) {
+        Cell start = this->maze.cell(startPos.i, startPos.j);
+        Cell target = this->maze.cell(targetPos.i, targetPos.j);
+
+        this->beginSearch(start);
+        this->markVisited(start);
+        if(start == target || !this->maze.isOpen(start) || !this->maze.isOpen(target) || this->skipSearch(start, target)) {
+            return;
+        }
+        if(!built || builtHash != this->maze.contentHash()) {
+            build(builtThreads);
+        }
+
+        // Start and target join the graph for this query only
+        int s = int(nodeCell.size()), t = s + 1;
+        nodeCell.push_back(start);
+        nodeCell.push_back(target);
+        edges.resize(t + 1);
+
+        const vector<int> &startTile = tileNodes[tileOf(start)], &targetTile = tileNodes[tileOf(target)];
+        searchFrom(start);
+        for(size_t k = 0; k < startTile.size(); k++) {
+            uint32_t distance = scratch.dist[local(nodeCell[startTile[k]])];
+            if(distance != UNREACHABLE) {
+                Edge e = { startTile[k], distance };
+                edges[s].push_back(e);
+            }
+        }
+        if(tileOf(start) == tileOf(target) && scratch.dist[local(target)] != UNREACHABLE) {
+            Edge e = { t, scratch.dist[local(target)] };
+            edges[s].push_back(e);
+        }
+
+        searchFrom(target);
+        vector<int> linked;
+        for(size_t k = 0; k < targetTile.size(); k++) {
+            uint32_t distance = scratch.dist[local(nodeCell[targetTile[k]])];
+            if(distance != UNREACHABLE) {
+                Edge e = { t, distance };
+                edges[targetTile[k]].push_back(e);
+                linked.push_back(targetTile[k]);
+            }
+        }
+
+        bool found = searchAbstract(s, t);
+
+        for(size_t k = 0; k < linked.size(); k++) {
+            edges[linked[k]].pop_back();
+        }
+        vector<int> route;
+        for(int n = t; found && n != -1; n = parent[n]) {
+            route.push_back(n);
+        }
+        reverse(route.begin(), route.end());
+        vector<Cell> routeCells;
+        for(size_t k = 0; k < route.size(); k++) {
+            routeCells.push_back(nodeCell[route[k]]);
+        }
+        nodeCell.resize(s);
+        edges.resize(s);
+
+        // Refine the abstract path, dropping any loop where two refined pieces cross
+        vector<Cell> cells(1, start);
+        for(size_t k = 1; k < routeCells.size(); k++) {
+            Cell from = routeCells[k - 1], to = routeCells[k];
+            if(tileOf(from) != tileOf(to)) {
+                cells.push_back(to);
+            }
+            else {
+                appendTilePath(from, to, cells);
+            }
+        }
+
+        vector<Cell> path;
+        unordered_map<Cell, size_t> at;
+        for(size_t k = 0; k < cells.size(); k++) {
+            unordered_map<Cell, size_t>::iterator it = at.find(cells[k]);
+            if(it != at.end()) {
+                while(path.size() > it->second + 1) {
+                    at.erase(path.back());
+                    path.pop_back();
+                }
+                continue;
+            }
+            at[cells[k]] = path.size();
+            path.push_back(cells[k]);
+        }
+
+        for(size_t k = 1; k < path.size(); k++) {
+            for(int d = UP; d <= RIGHT; d++) {
+                if(this->maze.neighbor(path[k - 1], Direction(d)) == path[k]) {
+                    this->setPrev(path[k], Direction(d));
+                }
+            }
+            this->markVisited(path[k]);
+        }
+    }
+};
+
+// Least recently used paths of a path finder, saved as move strings (see
+// PathFinder::pathMoves) under the maze content hash and the endpoints, so a
+// route asked again is answered without a search. Changing any cell changes
+// the hash, after which the saved paths are dropped on the next lookup.
+class PathCache {
+private:
+    struct Key {
+        uint64_t hash;
+        Pos start, end;
+
+        bool operator==(const Key& o) const {
+            return hash == o.hash && start == o.start && end == o.end;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            uint64_t h = key.hash;
+            h = (h ^ uint32_t(key.start.i)) * 1099511628211ULL;
+            h = (h ^ uint32_t(key.start.j)) * 1099511628211ULL;
+            h = (h ^ uint32_t(key.end.i)) * 1099511628211ULL;
+            h = (h ^ uint32_t(key.end.j)) * 1099511628211ULL;
+            return size_t(h ^ (h >> 32));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        bool found;
+        string moves;
+    };
+
+    Maze &maze;
+    PathFinder &finder;
+    size_t capacity;
+    list<Entry> entries; // most recently used first
+    unordered_map<Key, list<Entry>::iterator, KeyHash> index;
+    uint64_t mazeHash; // content hash the entries were found in
+    size_t hits, misses, invalidations;
+
+public:
+    PathCache(Maze &maze_, PathFinder &finder_, size_t capacity_ = 1024) :
+        maze(maze_),
+        finder(finder_),
+        capacity(max(capacity_, size_t(1))),
+        mazeHash(maze_.contentHash()),
+        hits(0),
+        misses(0),
+        invalidations(0) {
+
+    }
+
+    // Sets moves to the path from start to end as finder.pathMoves would and
+    // returns true, or returns false if end cannot be reached. Only a miss
+    // runs the finder.
+    bool route(Pos start, Pos end, string &moves) {
+        uint64_t current = maze.contentHash();
+        if(current != mazeHash) {
+            invalidations += entries.size();
+            entries.clear();
+            index.clear();
+            mazeHash = current;
+        }
+
+        Key key = {current, start, end};
+        unordered_map<Key, list<Entry>::iterator, KeyHash>::iterator it = index.find(key);
+        if(it != index.end()) {
+            hits++;
+            entries.splice(entries.begin(), entries, it->second);
+            moves = it->second->moves;
+            return it->second->found;
+        }
+
+        misses++;
+        finder.findPath(start, end);
+        Entry entry = {key, finder.pathLength(end) >= 0, finder.pathMoves(end)};
+        if(entries.size() == capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+        entries.push_front(entry);
+        index[key] = entries.begin();
+
+        moves = entry.moves;
+        return entry.found;
+    }
+
+    size_t hitCount() const {
+        return hits;
+    }
+
+    size_t missCount() const {
+        return misses;
+    }
+
+    // Paths dropped because the maze changed
+    size_t invalidationCount() const {
+        return invalidations;
+    }
+
+    double hitRate() const {
+        return hits + misses ? double(hits) / (hits + misses) : 0;
+    }
+};
+
+// Fills dist with the number of moves from source to every cell of the padded
+// grid, UNREACHABLE for walls and cells in other components
+void bfsDistances(const Maze &maze, Cell source, vector<uint32_t> &dist) {
+    dist.assign(maze.cellCount(), UNREACHABLE);
+    dist[source] = 0;
+
+    vector<Cell> frontier(1, source), next;
+    for(uint32_t distance = 1; !frontier.empty(); distance++) {
+        for(size_t k = 0; k < frontier.size(); k++) {
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell c = maze.neighbor(frontier[k], Direction(d));
+
+                if(maze.isOpen(c) && dist[c] == UNREACHABLE) {
+                    dist[c] = distance;
+                    next.push_back(c);
+                }
+            }
+        }
+        frontier.swap(next);
+        next.clear();
+    }
+}
+
+// Distance and direction to the nearest of many sources for every cell, e.g. to
+// the exits of a map, so that any number of agents reach an exit by following
+// the directions from wherever they stand. The wave from all the sources grows
+// one BFS level at a time on bit rows, 64 cells per word operation: the next
+// level is the open, unreached cells beside a frontier cell to the left or
+// right, or in the row above or below. Each thread owns a block of rows and
+// writes only those, and only the words next to the span of frontier words in
+// each row are looked at. The field is 2 bits per cell, the move towards the
+// nearest source, also written a word of cells at a time; distances, 4 bytes
+// per cell, are kept on request.
+class FlowField {
+private:
+    const Maze &maze;
+    int threads;
+    int rowsPerBlock;
+    size_t rowWords; // words per padded row
+    BitGrid reached, sources;
+    BitGrid levels[2]; // the frontier and the next level, by level parity
+
+    // First and last word of a padded row holding cells of a level
+    struct Span {
+        int low, high;
+
+        bool empty() const {
+            return low > high;
+        }
+    };
+    vector<Span> spans[2]; // by level parity and padded row
+    vector<vector<int> > active; // per thread, padded rows of its block holding frontier cells
+    vector<char> busy[2];
+    vector<uint64_t> toward; // 2-bit Direction codes, two words for each word of cells
+    vector<uint32_t> dist;
+    bool keepDistances;
+    uint32_t farthest;
+
+    // The low 32 bits of x moved to the even bits
+    static uint64_t spread(uint64_t x) {
+        x &= 0xFFFFFFFFULL;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x << 2)) & 0x3333333333333333ULL;
+        return (x | (x << 1)) & 0x5555555555555555ULL;
+    }
+
+    // Next level cells of padded row r, returning whether there are any
+    bool growRow(int r, int parity, uint32_t level) {
+        const uint64_t *walls = maze.wallWords(), *frontier = levels[parity].data();
+        uint64_t *next = levels[parity ^ 1].data(), *seen = reached.data();
+        const vector<Span> &near = spans[parity];
+        Span &grown = spans[parity ^ 1][r];
+
+        // Words beside the frontier words of this row and the rows around it
+        int low = min(near[r - 1].low, min(near[r].low, near[r + 1].low)) - 1;
+        int high = max(near[r - 1].high, max(near[r].high, near[r + 1].high)) + 1;
+        low = max(low, 0);
+        high = min(high, int(rowWords) - 1);
+
+        for(size_t w = r * rowWords + low; w <= r * rowWords + high; w++) {
+            // Cells whose frontier neighbor lies in each Direction; the padding keeps
+            // the words before and after a row free of frontier cells
+            uint64_t from[4] = {
+                frontier[w - rowWords],
+                (frontier[w] << 1) | (frontier[w - 1] >> 63),
+                frontier[w + rowWords],
+                (frontier[w] >> 1) | (frontier[w + 1] << 63)
+            };
+            uint64_t found = (from[UP] | from[LEFT] | from[DOWN] | from[RIGHT]) & ~walls[w] & ~seen[w];
+            if(!found) {
+                continue;
+            }
+            next[w] = found;
+            seen[w] |= found;
+            grown.low = min(grown.low, int(w - r * rowWords));
+            grown.high = int(w - r * rowWords);
+
+            // Ties go to the first Direction; the code bits are 1 for LEFT and
+            // RIGHT and 2 for DOWN and RIGHT
+            uint64_t up = found & from[UP], left = found & ~up & from[LEFT];
+            uint64_t down = found & ~up & ~left & from[DOWN], right = found & ~up & ~left & ~down;
+            uint64_t low = left | right, high = down | right;
+            for(int half = 0; half < 2; half++) {
+                int shift = half * 32;
+                uint64_t &codes = toward[2 * w + half];
+                codes = (codes & ~(spread(found >> shift) * 3)) | spread(low >> shift) | (spread(high >> shift) << 1);
+            }
+
+            if(keepDistances) {
+                for(uint64_t cells = found; cells; cells &= cells - 1) {
+                    dist[w * 64 + __builtin_ctzll(cells)] = level;
+                }
+            }
+        }
+        return !grown.empty();
+    }
+
+    void worker(int t, Barrier &barrier) {
+        int first = t * rowsPerBlock + 1, last = min((t + 1) * rowsPerBlock, maze.getSize()) + 1; // padded rows
+        vector<int> grown;
+
+        for(uint32_t level = 1; ; level++) {
+            int parity = (level - 1) & 1;
+
+            // Rows beside the frontier in ascending order, each once
+            int done = first - 1;
+            auto grow = [&](int r) {
+                if(r > done && r >= first && r < last) {
+                    done = r;
+                    if(growRow(r, parity, level)) {
+                        grown.push_back(r);
+                    }
+                }
+            };
+            if(!spans[parity][first - 1].empty()) {
+                grow(first);
+            }
+            for(size_t k = 0; k < active[t].size(); k++) {
+                grow(active[t][k] - 1);
+                grow(active[t][k]);
+                grow(active[t][k] + 1);
+            }
+            if(!spans[parity][last].empty()) {
+                grow(last - 1);
+            }
+
+            busy[parity][t] = !grown.empty();
+            barrier.wait();
+
+            if(count(busy[parity].begin(), busy[parity].end(), 1) == 0) {
+                if(t == 0) {
+                    farthest = level - 1;
+                }
+                return;
+            }
+
+            // The frontier is spent: clear its rows for the level after next
+            uint64_t *frontier = levels[parity].data();
+            for(size_t k = 0; k < active[t].size(); k++) {
+                Span &span = spans[parity][active[t][k]];
+                uint64_t *row = frontier + active[t][k] * rowWords;
+                fill(row + span.low, row + span.high + 1, 0);
+                span.low = int(rowWords);
+                span.high = -1;
+            }
+            active[t].swap(grown);
+            grown.clear();
+        }
+    }
+
+public:
+    FlowField(const Maze &maze_, int threads_ = thread::hardware_concurrency()) :
+        maze(maze_),
+        threads(max(1, min(threads_, maze_.getSize()))),
+        rowsPerBlock((maze_.getSize() + threads - 1) / threads),
+        rowWords(maze_.getStride() / 64),
+        keepDistances(false),
+        farthest(0) {
+        threads = (maze_.getSize() + rowsPerBlock - 1) / rowsPerBlock; // no thread without rows
+    }
+
+    // Grows the field from the open cells among sources
+    void build(const vector<Pos> &sourcePositions, bool withDistances = false) {
+        size_t cells = maze.cellCount();
+        reached = BitGrid(cells);
+        sources = BitGrid(cells);
+        levels[0] = BitGrid(cells);
+        levels[1] = BitGrid(cells);
+        toward.assign(2 * reached.wordCount(), 0);
+        keepDistances = withDistances;
+        dist.assign(keepDistances ? cells : 0, UNREACHABLE);
+        farthest = 0;
+        Span none = { int(rowWords), -1 };
+        for(int p = 0; p < 2; p++) {
+            spans[p].assign(maze.getSize() + 2, none);
+            busy[p].assign(threads, 0);
+        }
+        active.assign(threads, vector<int>());
+
+        for(size_t s = 0; s < sourcePositions.size(); s++) {
+            Pos p = sourcePositions[s];
+            if(!maze.isValidPosition(p.i, p.j) || maze.isWall(p.i, p.j)) {
+                continue;
+            }
+            Cell c = maze.cell(p.i, p.j);
+            sources.set(c);
+            reached.set(c);
+            levels[0].set(c);
+            if(keepDistances) {
+                dist[c] = 0;
+            }
+            Span &span = spans[0][p.i + 1];
+            span.low = min(span.low, int((p.j + 1) / 64));
+            span.high = max(span.high, int((p.j + 1) / 64));
+        }
+        for(int r = 1; r <= maze.getSize(); r++) {
+            if(!spans[0][r].empty()) {
+                active[(r - 1) / rowsPerBlock].push_back(r);
+            }
+        }
+
+        Barrier barrier(threads);
+        vector<thread> pool;
+        for(int t = 1; t < threads; t++) {
+            pool.push_back(thread(&FlowField::worker, this, t, ref(barrier)));
+        }
+        worker(0, barrier);
+        for(size_t t = 0; t < pool.size(); t++) {
+            pool[t].join();
+        }
+    }
+
+    bool isReachable(Pos p) const {
+        return maze.isValidPosition(p.i, p.j) && reached.test(maze.cell(p.i, p.j));
+    }
+
+    bool isSource(Pos p) const {
+        return maze.isValidPosition(p.i, p.j) && sources.test(maze.cell(p.i, p.j));
+    }
+
+    // Move from p towards the nearest source, for a reachable cell other than a source
+    Direction direction(Pos p) const {
+        Cell c = maze.cell(p.i, p.j);
+        return Direction((toward[c >> 5] >> ((c & 31) * 2)) & 3);
+    }
+
+    // Cell after p on the way to the nearest source
+    Pos follow(Pos p) const {
+        return maze.pos(maze.neighbor(maze.cell(p.i, p.j), direction(p)));
+    }
+
+    // Moves from p to the nearest source, UNREACHABLE for walls, unreached
+    // cells and when the distances were not kept
+    uint32_t distance(Pos p) const {
+        return keepDistances && maze.isValidPosition(p.i, p.j) ? dist[maze.cell(p.i, p.j)] : UNREACHABLE;
+    }
+
+    // Distance of the cell farthest from every source
+    uint32_t maxDistance() const {
+        return farthest;
+    }
+};
+
+// Landmark (ALT) distance oracle for a static maze. Preprocessing stores the
+// BFS distance from a few landmarks, picked farthest-first, to every cell. By
+// the triangle inequality every landmark L bounds a query from both sides,
+//     |d(a, L) - d(b, L)| <= d(a, b) <= d(a, L) + d(L, b),
+// and a landmark that reaches only one of the cells proves they are not
+// connected. When the tightest bounds meet the answer costs a few table
+// lookups. Otherwise an A* search guided by the landmark bounds settles it,
+// which on a maze with well spread landmarks touches few cells off the path.
+class DistanceOracle {
+private:
+    const Maze &maze;
+    vector<Cell> landmarks;
+    vector<uint32_t> table; // landmark-major distances over the padded grid
+    StampGrid closed;
+
+    const uint32_t* distances(size_t landmark) const {
+        return table.data() + landmark * maze.cellCount();
+    }
+
+    int manhattan(Cell a, Cell b) const {
+        Pos p = maze.pos(a), q = maze.pos(b);
+        return abs(p.i - q.i) + abs(p.j - q.j);
+    }
+
+    // Lower bound on the distance between a and b
+    long long lowerBound(Cell a, Cell b) const {
+        long long bound = manhattan(a, b);
+        for(size_t l = 0; l < landmarks.size(); l++) {
+            uint32_t da = distances(l)[a], db = distances(l)[b];
+            if(da != UNREACHABLE && db != UNREACHABLE) {
+                bound = max(bound, llabs((long long)da - db));
+            }
+        }
+        return bound;
+    }
+
+    long long search(Cell source, Cell target) {
+        closed.clear();
+
+        priority_queue<SearchNode> open;
+        open.push(SearchNode(lowerBound(source, target), 0, source, source, -1));
+
+        while(!open.empty()) {
+            SearchNode current = open.top();
+            open.pop();
+
+            if(closed.test(current.cell)) {
+                continue;
+            }
+            closed.set(current.cell);
+
+            if(current.cell == target) {
+                return current.g;
+            }
+
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell next = maze.neighbor(current.cell, Direction(d));
+
+                if(maze.isOpen(next) && !closed.test(next)) {
+                    long long g = current.g + 1;
+                    open.push(SearchNode(g + lowerBound(next, target), g, next, current.cell, d));
+                }
+            }
+        }
+        return -1;
+    }
+
+public:
+    struct Bounds {
+        long long lower, upper; // upper is -1 when no landmark reaches both cells
+        bool disconnected;
+    };
+
+    DistanceOracle(const Maze &maze_) : maze(maze_), closed(maze_.cellCount()) {}
+
+    // Picks count landmarks farthest-first in the largest connected part of the maze
+    void build(int count) {
+        landmarks.clear();
+        table.clear();
+
+        ComponentIndex components(maze);
+        components.build();
+        Cell first = components.largest();
+        if(!first) {
+            return;
+        }
+
+        // The cell farthest from first is the first landmark,
+        // each next one is the cell farthest from all the landmarks so far
+        vector<uint32_t> dist, nearest;
+        bfsDistances(maze, first, nearest);
+        for(int l = 0; l < count; l++) {
+            Cell farthest = first;
+            for(Cell c = 0; c < nearest.size(); c++) {
+                if(nearest[c] != UNREACHABLE && nearest[c] > nearest[farthest]) {
+                    farthest = c;
+                }
+            }
+            if(l > 0 && nearest[farthest] == 0) {
+                break; // every reachable cell is a landmark already
+            }
+
+            landmarks.push_back(farthest);
+            bfsDistances(maze, farthest, dist);
+            table.insert(table.end(), dist.begin(), dist.end());
+
+            if(l == 0) {
+                nearest = dist;
+            }
+            else {
+                for(Cell c = 0; c < nearest.size(); c++) {
+                    nearest[c] = min(nearest[c], dist[c]);
+                }
+            }
+        }
+    }
+
+    size_t landmarkCount() const {
+        return landmarks.size();
+    }
+
+    Bounds bounds(Pos a, Pos b) const {
+        Cell ca = maze.cell(a.i, a.j), cb = maze.cell(b.i, b.j);
+        Bounds result = { lowerBound(ca, cb), -1, false };
+
+        for(size_t l = 0; l < landmarks.size(); l++) {
+            uint32_t da = distances(l)[ca], db = distances(l)[cb];
+            if((da == UNREACHABLE) != (db == UNREACHABLE)) {
+                result.disconnected = true;
+            }
+            else if(da != UNREACHABLE && (result.upper < 0 || da + (long long)db < result.upper)) {
+                result.upper = da + (long long)db;
+            }
+        }
+        return result;
+    }
+
+    // Number of moves between a and b, -1 if there is no path
+    long long distance(Pos a, Pos b) {
+        if(!maze.isValidPosition(a.i, a.j) || !maze.isValidPosition(b.i, b.j) ||
+           maze.isWall(a.i, a.j) || maze.isWall(b.i, b.j)) {
+            return -1;
+        }
+
+        Bounds range = bounds(a, b);
+        if(range.disconnected) {
+            return -1;
+        }
+        if(range.upper == range.lower) {
+            return range.upper;
+        }
+        return search(maze.cell(a.i, a.j), maze.cell(b.i, b.j));
+    }
+
+    // File layout: "MAZEALT1", maze checksum, landmark count, landmark cells,
+    // then the distance tables in native byte order
+    bool save(const string &fileName) const {
+        ofstream out(fileName.c_str(), ios::binary);
+        uint64_t checksum = maze.checksum(), count = landmarks.size();
+
+        out.write("MAZEALT1", 8);
+        out.write((const char *)&checksum, sizeof(checksum));
+        out.write((const char *)&count, sizeof(count));
+        out.write((const char *)landmarks.data(), count * sizeof(Cell));
+        out.write((const char *)table.data(), table.size() * sizeof(uint32_t));
+        return bool(out);
+    }
+
+    // Fails if the file is missing or was built for a different maze
+    bool load(const string &fileName) {
+        ifstream in(fileName.c_str(), ios::binary);
+        char magic[8];
+        uint64_t checksum, count;
+
+        if(!in.read(magic, 8) || string(magic, 8) != "MAZEALT1" ||
+           !in.read((char *)&checksum, sizeof(checksum)) || checksum != maze.checksum() ||
+           !in.read((char *)&count, sizeof(count))) {
+            return false;
+        }
+
+        landmarks.resize(count);
+        table.resize(count * maze.cellCount());
+        in.read((char *)landmarks.data(), count * sizeof(Cell));
+        in.read((char *)table.data(), table.size() * sizeof(uint32_t));
+        return bool(in);
+    }
+};
+
+// Seconds spent running work
+template<class Work>
+double timed(Work work) {
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+    work();
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+// Seconds spent by finder.findPath(start, end)
+double timeSearch(PathFinder &finder, Pos start, Pos end) {
+    return timed([&]() { finder.findPath(start, end); });
+}
+
+// Starts a line of the benchmark report: the name, then value in a column;
+// the caller appends the unit and anything else
+ostream& reportLine(const string &name, double value) {
+    return cout << "  " << setw(18) << left << name << right << setw(10) << value;
+}
+
+// Random open cell within radius rows and columns of center
+Pos randomOpenCell(Maze &maze, mt19937 &rng, Pos center, int radius) {
+    int N = maze.getSize();
+    for(;;) {
+        int i = min(N - 1, max(0, center.i - radius + int(rng() % (2 * radius + 1))));
+        int j = min(N - 1, max(0, center.j - radius + int(rng() % (2 * radius + 1))));
+        if(!maze.isWall(i, j)) {
+            return Pos(i, j);
+        }
+    }
+}
+
+// Queries per second answered by one finder between random nearby cells
+// connected to each other
+void reportQueries(const char *name, PathFinder &finder, Maze &maze, int queries, int radius) {
+    mt19937 rng(queries);
+    BidirectionalBFSPathFinder check(maze);
+    vector<pair<Pos, Pos> > pairs;
+    while(int(pairs.size()) < queries) {
+        Pos a = randomOpenCell(maze, rng, Pos(maze.getSize() / 2, maze.getSize() / 2), maze.getSize() / 2);
+        Pos b = randomOpenCell(maze, rng, a, radius);
+        check.findPath(a, b);
+        if(check.pathLength(b) >= 0) {
+            pairs.push_back(make_pair(a, b));
+        }
+    }
+
+    double seconds = timed([&]() {
+        for(int q = 0; q < queries; q++) {
+            finder.findPath(pairs[q].first, pairs[q].second);
+        }
+    });
+    reportLine(name, queries / seconds) << " queries/s" << endl;
+}
+
+void reportSearch(const char *name, PathFinder &finder, Pos start, Pos end) {
+    reportLine(name, timeSearch(finder, start, end)) << " s, path length " << finder.pathLength(end) << endl;
+}
+
+// Maze generators for the benchmarks, all seeded so that a run can be repeated
+
+// Every cell a wall with a wallPercent percent chance
+Maze randomMaze(int N, int wallPercent, unsigned seed) {
+    Maze maze(N);
+    mt19937 rng(seed);
+    for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+            if(int(rng() % 100) < wallPercent) {
+                maze.setWall(maze.cell(i, j), true);
+            }
+        }
+    }
+    return maze;
+}
+
+Maze solidMaze(int N) {
+    Maze maze(N);
+    for(int i = 0; i < N; i++) {
+        for(int j = 0; j < N; j++) {
+            maze.setWall(maze.cell(i, j), true);
+        }
+    }
+    return maze;
+}
+
+// A single corridor winding through the whole maze: every even row open, every
+// odd row a wall but for one end, alternating between the right and the left.
+// The path from (0 0) to the far end of the last row takes about N * N / 2
+// moves.
+Maze serpentineMaze(int N) {
+    Maze maze(N);
+    for(int i = 1; i < N; i += 2) {
+        for(int j = 0; j < N; j++) {
+            if(j != (i % 4 == 1 ? N - 1 : 0)) {
+                maze.setWall(maze.cell(i, j), true);
+            }
+        }
+    }
+    return maze;
+}
+
+// Perfect maze carved by a randomized depth-first search over the cells with
+// even coordinates. The move into every carved cell is kept in a direction
+// grid, so backtracking needs no stack.
+Maze backtrackerMaze(int N, unsigned seed) {
+    const int di[4] = { -1, 0, 1, 0 }, dj[4] = { 0, -1, 0, 1 };
+    Maze maze = solidMaze(N);
+    mt19937 rng(seed);
+    DirectionGrid came(maze.cellCount());
+
+    Pos start(0, 0), current = start;
+    maze.setWall(maze.cell(0, 0), false);
+    for(;;) {
+        int options[4], count = 0;
+        for(int d = UP; d <= RIGHT; d++) {
+            int i = current.i + 2 * di[d], j = current.j + 2 * dj[d];
+            if(maze.isValidPosition(i, j) && maze.isWall(i, j)) {
+                options[count++] = d;
+            }
+        }
+
+        if(count == 0) {
+            if(current == start) {
+                return maze;
+            }
+            int back = came.get(maze.cell(current.i, current.j)) ^ 2;
+            current = Pos(current.i + 2 * di[back], current.j + 2 * dj[back]);
+            continue;
+        }
+
+        int d = options[rng() % count];
+        maze.setWall(maze.cell(current.i + di[d], current.j + dj[d]), false);
+        current = Pos(current.i + 2 * di[d], current.j + 2 * dj[d]);
+        maze.setWall(maze.cell(current.i, current.j), false);
+        came.set(maze.cell(current.i, current.j), Direction(d));
+    }
+}
+
+// Opens the cells of an L-shaped corridor from a along the row of a, then
+// along the column of b
+void carveCorridor(Maze &maze, Pos a, Pos b) {
+    for(int j = min(a.j, b.j); j <= max(a.j, b.j); j++) {
+        maze.setWall(maze.cell(a.i, j), false);
+    }
+    for(int i = min(a.i, b.i); i <= max(a.i, b.i); i++) {
+        maze.setWall(maze.cell(i, b.j), false);
+    }
+}
+
+// A room of random size in every block of a coarse grid, each room joined by
+// a corridor to the next one in its row and to the one below it in the first
+// column and in about a third of the others, so all the rooms are connected
+Maze roomsMaze(int N, unsigned seed) {
+    if(N < 3) {
+        return Maze(N);
+    }
+
+    Maze maze = solidMaze(N);
+    mt19937 rng(seed);
+    int blocks = max(1, N / 32), blockSize = N / blocks;
+    int span = blockSize - 2, shortest = max(1, span / 3); // room sides within a block
+
+    vector<Pos> centers;
+    for(int bi = 0; bi < blocks; bi++) {
+        for(int bj = 0; bj < blocks; bj++) {
+            int height = shortest + rng() % (span - shortest + 1), width = shortest + rng() % (span - shortest + 1);
+            int top = bi * blockSize + 1 + rng() % (span - height + 1);
+            int left = bj * blockSize + 1 + rng() % (span - width + 1);
+
+            for(int i = top; i < top + height; i++) {
+                for(int j = left; j < left + width; j++) {
+                    maze.setWall(maze.cell(i, j), false);
+                }
+            }
+            centers.push_back(Pos(top + height / 2, left + width / 2));
+        }
+    }
+
+    for(int bi = 0; bi < blocks; bi++) {
+        for(int bj = 0; bj < blocks; bj++) {
+            if(bj + 1 < blocks) {
+                carveCorridor(maze, centers[bi * blocks + bj], centers[bi * blocks + bj + 1]);
+            }
+            if(bi + 1 < blocks && (bj == 0 || rng() % 3 == 0)) {
+                carveCorridor(maze, centers[bi * blocks + bj], centers[(bi + 1) * blocks + bj]);
+            }
+        }
+    }
+    return maze;
+}
+
+// Corner to corner searches on an open N x N grid, where DFS goes as deep as
+// there are cells, then the other engines between two points of a grid with 30%
+// random walls, the parallel BFS with 1, 2, 4, ... threads up to all cores.
+void benchmark(int N) {
+    int cores = max(1, int(thread::hardware_concurrency()));
+
+    cout << "Open " << N << "x" << N << " grid, (0 0) -> (" << N - 1 << " " << N - 1 << ")" << endl;
+    {
+        Maze maze(N);
+        DFSPathFinder dfs(maze);
+        reportSearch("DFS", dfs, Pos(0, 0), Pos(N - 1, N - 1));
+    }
+    {
+        Maze maze(N);
+        BFSPathFinder bfs(maze);
+        reportSearch("BFS", bfs, Pos(0, 0), Pos(N - 1, N - 1));
+    }
+    {
+        Maze maze(N);
+        BitParallelBFSPathFinder bitParallel(maze);
+        reportSearch("Bit-parallel BFS", bitParallel, Pos(0, 0), Pos(N - 1, N - 1));
+    }
+
+    Maze maze = randomMaze(N, 30, 2018);
+
+    Pos start(3 * N / 8, 3 * N / 8), end(5 * N / 8, 5 * N / 8);
+    maze[start.i][start.j] = '1';
+    maze[end.i][end.j] = '1';
+
+    cout << "30% walls " << N << "x" << N << " grid, (" << start.i << " " << start.j << ") -> ("
+         << end.i << " " << end.j << ")" << endl;
+    {
+        BFSPathFinder bfs(maze);
+        reportSearch("BFS", bfs, start, end);
+    }
+    {
+        BidirectionalBFSPathFinder bidirectional(maze);
+        reportSearch("Bidirectional BFS", bidirectional, start, end);
+    }
+    {
+        BitParallelBFSPathFinder bitParallel(maze);
+        reportSearch("Bit-parallel BFS", bitParallel, start, end);
+    }
+    for(int threads = 1; ; threads = min(2 * threads, cores)) {
+        ParallelBFSPathFinder parallel(maze, threads);
+        string name = "Parallel BFS x" + to_string(threads);
+        reportSearch(name.c_str(), parallel, start, end);
+        if(threads == cores) {
+            break;
+        }
+    }
+    {
+        AStarPathFinder aStar(maze);
+        reportSearch("A*", aStar, start, end);
+    }
+    {
+        JumpPointPathFinder jumpPoint(maze);
+        reportSearch("Jump Point Search", jumpPoint, start, end);
+    }
+    {
+        HierarchicalPathFinder hierarchical(maze);
+        double seconds = timed([&]() { hierarchical.build(cores); });
+        reportLine("HPA* build", seconds) << " s, " << hierarchical.nodeCount() << " abstract nodes" << endl;
+        reportSearch("HPA*", hierarchical, start, end);
+    }
 
-public:
-    Maze(int N) : 
-        raw(N, vector<char>(N, '1')), 
-        size(N) {}
+    cout << "8-connected moves on the same grid" << endl;
+    {
+        BasicBFSPathFinder<EightConnected<CUT_CORNERS> > bfs(maze);
+        reportSearch("BFS", bfs, start, end);
+    }
+    {
+        BasicAStarPathFinder<EightConnected<NO_CORNER_CUTTING> > aStar(maze);
+        reportSearch("A* no cutting", aStar, start, end);
+    }
+    {
+        BasicAStarPathFinder<EightConnected<CUT_CORNERS> > aStar(maze);
+        reportSearch("A* cut corners", aStar, start, end);
+    }
+    {
+        BasicAStarPathFinder<EightConnected<SQUEEZE> > aStar(maze);
+        reportSearch("A* squeeze", aStar, start, end);
+    }
 
-    Maze(const Maze& other) : raw(other.raw), size(other.size) {}
+    // Octile costs of a path this long pass 2^31 from N = 7900 on; both finders
+    // have to report the same length
+    cout << "Serpentine corridor " << N << "x" << N << endl;
+    {
+        Maze winding = serpentineMaze(N);
+        int last = N - 1 - (N - 1) % 2; // last open row
+        Pos far(last, last % 4 == 0 ? N - 1 : 0);
+        {
+            BFSPathFinder bfs(winding);
+            reportSearch("BFS", bfs, Pos(0, 0), far);
+        }
+        {
+            BasicAStarPathFinder<EightConnected<NO_CORNER_CUTTING> > aStar(winding);
+            reportSearch("A* no cutting", aStar, Pos(0, 0), far);
+        }
+    }
 
-    bool isValidPosition(int i, int j) const {
-        return i >= 0 && j >= 0 && i < size && j < size;
+    cout << "1000 connected pairs within 32 cells on the same grid" << endl;
+    {
+        BFSPathFinder bfs(maze);
+        reportQueries("BFS", bfs, maze, 1000, 32);
+    }
+    {
+        AStarPathFinder aStar(maze);
+        reportQueries("A*", aStar, maze, 1000, 32);
     }
 
-    bool isWall(int i, int j) const {
-        return raw[i][j] == '0';
+    cout << "Component labels on " << cores << " threads" << endl;
+    {
+        ComponentIndex components(maze);
+        double seconds = timed([&]() { components.build(cores); });
+        reportLine("build", seconds) << " s, " << components.count() << " components" << endl;
+
+        mt19937 rng(1000);
+        Pos pocket = start;
+        while(components.connected(start, pocket)) {
+            pocket = randomOpenCell(maze, rng, Pos(N / 2, N / 2), N / 2);
+        }
+
+        BFSPathFinder bfs(maze);
+        reportSearch("BFS to a pocket", bfs, start, pocket);
+        bfs.useComponents(&components);
+        reportSearch("  with labels", bfs, start, pocket);
     }
 
-    int getSize() const {
-        return size;
+    cout << "Path cache of 256 routes, 10000 queries over 500 pairs" << endl;
+    {
+        Maze changing(maze);
+        mt19937 rng(500);
+        vector<pair<Pos, Pos> > pairs;
+        for(int p = 0; p < 500; p++) {
+            Pos a = randomOpenCell(changing, rng, Pos(N / 2, N / 2), N / 2);
+            pairs.push_back(make_pair(a, randomOpenCell(changing, rng, a, 64)));
+        }
+
+        BidirectionalBFSPathFinder bidirectional(changing);
+        PathCache cache(changing, bidirectional, 256);
+        geometric_distribution<int> popular(0.01); // a few routes are asked most of the time
+        string moves;
+        double seconds = timed([&]() {
+            for(int q = 0; q < 10000; q++) {
+                const pair<Pos, Pos> &route = pairs[min(popular(rng), 499)];
+                cache.route(route.first, route.second, moves);
+            }
+        });
+        reportLine("cached", 10000 / seconds) << " queries/s, " << int(cache.hitRate() * 100) << "% hits" << endl;
+
+        bidirectional.findPath(pairs[0].first, pairs[0].second);
+        vector<Pos> path = bidirectional.path(pairs[0].second);
+        if(path.size() > 2) {
+            changing[path[1].i][path[1].j] = '0';
+        }
+        cache.route(pairs[0].first, pairs[0].second, moves);
+        reportLine("after a new wall", cache.invalidationCount()) << " paths dropped" << endl;
+    }
+
+    cout << "Flow field to 100 random exits on " << cores << " threads" << endl;
+    {
+        mt19937 rng(100);
+        vector<Pos> exits;
+        for(int e = 0; e < 100; e++) {
+            exits.push_back(randomOpenCell(maze, rng, Pos(N / 2, N / 2), N / 2));
+        }
+
+        FlowField field(maze, cores);
+        double seconds = timed([&]() { field.build(exits); });
+        reportLine("directions", seconds) << " s, farthest cell " << field.maxDistance() << " moves away" << endl;
+
+        seconds = timed([&]() { field.build(exits, true); });
+        reportLine("with distances", seconds) << " s" << endl;
+    }
+
+    cout << "D* Lite, then replanning after walls land on the path" << endl;
+    {
+        Maze changing(maze);
+        DStarLitePathFinder planner(changing);
+        reportLine("initial plan", timeSearch(planner, start, end)) << " s, " << planner.expansions()
+            << " cells expanded, path length " << planner.pathLength(end) << endl;
+
+        for(int wall = 1; wall <= 3; wall++) {
+            vector<Pos> path = planner.path(end);
+            if(path.size() < 3) {
+                break;
+            }
+            planner.setWall(path[path.size() * wall / 4], true);
+            reportLine("replan " + to_string(wall), timeSearch(planner, start, end)) << " s, " << planner.expansions()
+                << " cells expanded, path length " << planner.pathLength(end) << endl;
+        }
+    }
+
+    cout << "Distance oracle with 4 landmarks, 1000 random pairs" << endl;
+    {
+        DistanceOracle oracle(maze);
+        reportLine("build", timed([&]() { oracle.build(4); })) << " s" << endl;
+
+        mt19937 rng(1000);
+        vector<pair<Pos, Pos> > pairs;
+        for(int q = 0; q < 1000; q++) {
+            pairs.push_back(make_pair(randomOpenCell(maze, rng, Pos(N / 2, N / 2), N / 2),
+                                      randomOpenCell(maze, rng, Pos(N / 2, N / 2), N / 2)));
+        }
+
+        int answered = 0;
+        double seconds = timed([&]() {
+            for(int q = 0; q < 1000; q++) {
+                DistanceOracle::Bounds range = oracle.bounds(pairs[q].first, pairs[q].second);
+                answered += range.disconnected || range.lower == range.upper;
+            }
+        });
+        reportLine("bounds", seconds / 1000 * 1e6) << " us/query, " << answered / 10.0 << "% exact" << endl;
+
+        seconds = timed([&]() {
+            for(int q = 0; q < 1000; q++) {
+                oracle.distance(pairs[q].first, pairs[q].second);
+            }
+        });
+        reportLine("distance", seconds / 1000 * 1e6) << " us/query" << endl;
     }
-    vector<char>& operator[](const int i) {
-        return raw[i];
+}
+
+const char *suiteEngines[] = { "DFS", "BFS", "Bidirectional BFS", "Bit-parallel BFS", "Parallel BFS", "A*",
+                               "Jump Point Search", "Dijkstra", "D* Lite", "HPA*", "8-connected BFS",
+                               "8-connected A*" };
+
+PathFinder* makeEngine(int engine, Maze &maze) {
+    switch(engine) {
+        case 0: return new DFSPathFinder(maze);
+        case 1: return new BFSPathFinder(maze);
+        case 2: return new BidirectionalBFSPathFinder(maze);
+        case 3: return new BitParallelBFSPathFinder(maze);
+        case 4: return new ParallelBFSPathFinder(maze);
+        case 5: return new AStarPathFinder(maze);
+        case 6: return new JumpPointPathFinder(maze);
+        case 7: return new DijkstraPathFinder(maze);
+        case 8: return new DStarLitePathFinder(maze);
+        case 9: return new HierarchicalPathFinder(maze);
+        case 10: return new BasicBFSPathFinder<EightConnected<CUT_CORNERS> >(maze);
+        default: return new BasicAStarPathFinder<EightConnected<NO_CORNER_CUTTING> >(maze);
     }
+}
 
+struct SuiteResult {
+    double seconds; // building the engine and searching
+    long long length;
+    long peakKB; // peak resident size, 0 where it cannot be measured
+    bool failed;
 };
 
-// Abstract class PathFinder
-class PathFinder {
-private:
-    int size;
-    vector<vector<Pos>> prevCell; // previous cell in the path (i.e. from which cell we arrived to the current in the traverse)
-    vector<vector<bool>> visited;
+// One engine's search from start to end. On POSIX it runs in a child process,
+// so the peak resident size is that of the maze and this engine alone and an
+// engine running out of memory does not end the suite.
+SuiteResult runEngine(int engine, Maze &maze, Pos start, Pos end) {
+    SuiteResult result = { 0, -1, 0, true };
+    auto run = [&]() {
+        PathFinder *finder = NULL;
+        result.seconds = timed([&]() {
+            finder = makeEngine(engine, maze);
+            finder->findPath(start, end);
+        });
+        result.length = finder->pathLength(end);
+        result.failed = false;
+        delete finder;
+    };
 
-protected:
-    Maze &maze;
+#ifndef _WIN32
+    int channel[2];
+    if(pipe(channel) == 0) {
+        cout.flush();
+        pid_t child = fork();
+        if(child == 0) {
+            close(channel[0]);
+            run();
+            ssize_t written = write(channel[1], &result, sizeof(result));
+            _exit(written == ssize_t(sizeof(result)) ? 0 : 1);
+        }
 
-public:    
-    virtual void findPath(Pos current, Pos target) = 0;
+        close(channel[1]);
+        if(child > 0) {
+            if(read(channel[0], &result, sizeof(result)) != ssize_t(sizeof(result))) {
+                result.failed = true;
+            }
+            struct rusage usage;
+            int status;
+            if(wait4(child, &status, 0, &usage) == child) {
+                result.peakKB = usage.ru_maxrss;
+            }
+        }
+        close(channel[0]);
+        return result;
+    }
+#endif
+    run();
+    return result;
+}
 
-    PathFinder(Maze &maze_) : 
-        maze(maze_), 
-        size(maze_.getSize()), 
-        prevCell(size, vector<Pos>(size)),
-        visited(size, vector<bool>(size, false)) {
+// Every engine on every generated maze of the given sizes, searching between
+// the first and the last open cell in row-major order. Throughput is counted
+// in cells of the whole grid per second of search, so engines that look at
+// fewer cells come out faster than the cells they actually touched would say.
+// The 8-connected engines also move diagonally, so their paths are shorter.
+void benchmarkSuite(const vector<int> &sizes) {
+    const char *generators[] = { "random 30%", "backtracker", "rooms" };
+
+    cout << setw(12) << left << "maze" << right << setw(7) << "size" << "  " << setw(18) << left << "engine"
+         << right << setw(11) << "seconds" << setw(12) << "Mcells/s" << setw(10) << "peak MB" << setw(10) << "length"
+         << endl;
+
+    for(size_t s = 0; s < sizes.size(); s++) {
+        int N = sizes[s];
+        for(int g = 0; g < 3; g++) {
+            Maze maze = g == 0 ? randomMaze(N, 30, 2018) : g == 1 ? backtrackerMaze(N, 2018) : roomsMaze(N, 2018);
+            if(g == 0) {
+                maze[0][0] = '1';
+                maze[N - 1][N - 1] = '1';
+            }
+
+            Cell first = maze.cellCount(), last = 0;
+            for(Cell c = 0; c < maze.cellCount(); c++) {
+                if(maze.isOpen(c)) {
+                    first = min(first, c);
+                    last = c;
+                }
+            }
+            if(first > last) {
+                continue;
+            }
+
+            for(int engine = 0; engine < int(sizeof(suiteEngines) / sizeof(suiteEngines[0])); engine++) {
+                SuiteResult result = runEngine(engine, maze, maze.pos(first), maze.pos(last));
+                cout << setw(12) << left << generators[g] << right << setw(7) << N << "  " << setw(18) << left
+                     << suiteEngines[engine] << right;
+                if(result.failed) {
+                    cout << setw(11) << "failed" << endl;
+                    continue;
+                }
+                cout << setw(11) << fixed << setprecision(3) << result.seconds
+                     << setw(12) << setprecision(1) << double(N) * N / result.seconds / 1e6
+                     << setw(10) << setprecision(0) << result.peakKB / 1024.0
+                     << setw(10) << result.length << defaultfloat << setprecision(6) << endl;
+            }
+        }
+    }
+}
+
+// Header of the binary maze format, followed by Maze::wordCount(size) wall
+// words in native byte order laid out exactly as in memory and, for weighted
+// mazes, a cost byte for each cell of the padded grid
+struct MazeFileHeader {
+    char magic[8]; // "MAZEBIT1"
+    uint64_t size;
+    uint64_t stride;
+    uint64_t maxCost; // 0 when no costs follow the walls
+    uint64_t reserved[4]; // keeps the words 64-byte aligned in the file
+};
+
+bool saveBinaryMaze(const Maze &maze, const string &fileName) {
+    MazeFileHeader header = { { 'M', 'A', 'Z', 'E', 'B', 'I', 'T', '1' },
+                              uint64_t(maze.getSize()), maze.getStride(),
+                              uint64_t(maze.isWeighted() ? maze.getMaxCost() : 0), { 0, 0, 0, 0 } };
+    ofstream out(fileName.c_str(), ios::binary);
 
+    out.write((const char *)&header, sizeof(header));
+    out.write((const char *)maze.wallWords(), Maze::wordCount(maze.getSize()) * sizeof(uint64_t));
+    if(maze.isWeighted()) {
+        out.write((const char *)maze.costBytes(), maze.cellCount());
     }
+    return bool(out);
+}
 
-    bool isVisited(int i, int j) const {
-        return visited[i][j];
+// Next token of a PBM header, skipping whitespace and # comments
+string pbmToken(istream &in) {
+    string token;
+    char c;
+    while(in.get(c)) {
+        if(c == '#') {
+            while(in.get(c) && c != '\n') {}
+        }
+        else if(isspace((unsigned char)c)) {
+            if(!token.empty()) {
+                break;
+            }
+        }
+        else {
+            token += c;
+        }
     }
+    return token;
+}
+
+void loadError(const string &fileName, const string &reason) {
+    cerr << "Error: cannot load maze " << fileName << ": " << reason << endl;
+    exit(-1);
+}
 
-    void markVisited(int i, int j) {
-        visited[i][j] = true;
+// Loads a square maze from fileName, which may be
+//  - the binary format of saveBinaryMaze, mapped into memory as is,
+//  - a PBM image (P1 or P4), black pixels being walls,
+//  - text with one row per line, '0' or '#' for walls, '1' or '.' for open
+//    cells and '2' to '9' for open cells costing that much to enter,
+//    optionally separated by spaces as printed by printPath.
+// Text and PBM files are parsed a row at a time straight into the wall bits.
+Maze loadMaze(const string &fileName) {
+    shared_ptr<MappedFile> file(new MappedFile());
+    if(!file->open(fileName)) {
+        loadError(fileName, "cannot open file");
     }
 
-    vector<Pos>& operator[](const int i) {
-        return prevCell[i];
+    if(file->size() >= sizeof(MazeFileHeader) && string(file->data(), 8) == "MAZEBIT1") {
+        MazeFileHeader header;
+        memcpy(&header, file->data(), sizeof(header));
+
+        int N = int(header.size);
+        size_t wallBytes = Maze::wordCount(N) * sizeof(uint64_t);
+        size_t costBytes = header.maxCost ? (N + 2) * Maze::paddedStride(N) : 0;
+        if(header.stride != Maze::paddedStride(N) || header.maxCost > 9 ||
+           file->size() != sizeof(header) + wallBytes + costBytes) {
+            loadError(fileName, "corrupt binary maze");
+        }
+
+        char *words = file->data() + sizeof(header);
+        return Maze(N, file, (uint64_t *)words, costBytes ? (uint8_t *)(words + wallBytes) : NULL,
+                    max(1, int(header.maxCost)));
     }
+    file.reset();
 
-    void printPath(Pos end) {
-        Maze temp(this->maze);
+    ifstream in(fileName.c_str(), ios::binary);
+    if(in.peek() == 'P') {
+        string format = pbmToken(in);
+        int width = atoi(pbmToken(in).c_str()), height = atoi(pbmToken(in).c_str());
+        if((format != "P1" && format != "P4") || width <= 0 || width != height) {
+            loadError(fileName, "expected a square P1 or P4 image");
+        }
 
-        while(temp.isValidPosition(end.i, end.j)) {
-            temp[end.i][end.j] = '*';
-            end = (*this)[end.i][end.j];
+        Maze maze(width);
+        vector<unsigned char> row((width + 7) / 8);
+        for(int i = 0; i < height; i++) {
+            if(format == "P4") {
+                if(!in.read((char *)row.data(), row.size())) {
+                    loadError(fileName, "truncated image");
+                }
+                for(int j = 0; j < width; j++) {
+                    maze.setWall(maze.cell(i, j), (row[j / 8] >> (7 - j % 8)) & 1);
+                }
+            }
+            else {
+                for(int j = 0; j < width; j++) {
+                    char c;
+                    while(in.get(c) && c != '0' && c != '1') {}
+                    if(!in) {
+                        loadError(fileName, "truncated image");
+                    }
+                    maze.setWall(maze.cell(i, j), c == '1');
+                }
+            }
         }
+        return maze;
+    }
 
+    string line;
+    vector<char> cells;
+    unique_ptr<Maze> maze;
+    int i = 0;
 
-        for(int i = 0; i < temp.getSize(); i++) {
-            for(int j = 0; j < temp.getSize(); j++) {
-                cout << temp[i][j] << " ";
+    while(getline(in, line)) {
+        cells.clear();
+        for(size_t k = 0; k < line.size(); k++) {
+            char c = line[k];
+            if(isdigit((unsigned char)c) || c == '#' || c == '.') {
+                cells.push_back(c);
             }
-            cout << endl;
+            else if(!isspace((unsigned char)c)) {
+                loadError(fileName, string("unexpected character '") + c + "'");
+            }
+        }
+        if(cells.empty()) {
+            continue;
+        }
+
+        if(!maze) {
+            maze.reset(new Maze(int(cells.size())));
+        }
+        if(int(cells.size()) != maze->getSize() || i >= maze->getSize()) {
+            loadError(fileName, "the maze is not square");
+        }
+        for(int j = 0; j < maze->getSize(); j++) {
+            maze->setCell(maze->cell(i, j), cells[j] == '#' ? '0' : cells[j]);
         }
+        i++;
     }
 
+    if(!maze || i != maze->getSize()) {
+        loadError(fileName, "the maze is not square");
+    }
+    return move(*maze);
+}
+
+// Sorted 64-bit values read back from a file through a buffer
+class ValueReader {
+private:
+    ifstream in;
+    vector<uint64_t> buffer;
+    size_t next, count;
+
+public:
+    ValueReader(const string &fileName) : in(fileName.c_str(), ios::binary), buffer(1 << 16), next(0), count(0) {}
+
+    // Next value into value, false at the end of the file
+    bool get(uint64_t &value) {
+        if(next == count) {
+            in.read((char *)buffer.data(), buffer.size() * sizeof(uint64_t));
+            count = in.gcount() / sizeof(uint64_t);
+            next = 0;
+            if(count == 0) {
+                return false;
+            }
+        }
+        value = buffer[next++];
+        return true;
+    }
 };
 
-class DFSPathFinder : public PathFinder {
+class ValueWriter {
+private:
+    ofstream out;
+    vector<uint64_t> buffer;
+    size_t written;
+
 public:
-    DFSPathFinder(Maze &maze_) : PathFinder(maze_) {}
+    ValueWriter(const string &fileName) : out(fileName.c_str(), ios::binary), written(0) {
+        buffer.reserve(1 << 16);
+    }
 
-    virtual void findPath(Pos current, Pos target) {
-        this->markVisited(current.i, current.j);
+    ~ValueWriter() {
+        flush();
+    }
 
-        if(this->isVisited(target.i, target.j)) {
-            return; // abort if a path to the target cell is already found
+    void put(uint64_t value) {
+        buffer.push_back(value);
+        written++;
+        if(buffer.size() == buffer.capacity()) {
+            flush();
         }
+    }
 
-        for(int k = - 1; k <= 1; k += 2) 
-        {
-            int i = current.i;
-            int j = current.j;
+    void flush() {
+        out.write((const char *)buffer.data(), buffer.size() * sizeof(uint64_t));
+        out.flush();
+        buffer.clear();
+    }
+
+    size_t count() const {
+        return written;
+    }
+};
+
+// Breadth-first search whose state lives on disk, after Munagala and Ranade.
+// In an undirected graph the neighbors of one BFS level can only be in the
+// level before, the level itself or the next one, so a level is found from
+// the last two alone: the neighbors of the current level are collected in a
+// memory buffer, written out as sorted runs whenever it fills, and the runs
+// are merged while the two old levels, sorted files as well, are subtracted.
+// Each level is expanded in cell order, so the wall bits of a mapped binary
+// maze are read one band of rows after another. The move into every reached
+// cell goes to a file of 2-bit codes laid out like DirectionGrid, mapped
+// shared, which is all the path needs, and removed with the search. Memory
+// use is the buffer and the pages the kernel chooses to keep.
+class ExternalBFS {
+private:
+    const Maze &maze;
+    string directory;
+    size_t bufferValues;
+    MappedFile parents;
+    Cell source, goal;
+    long long length;
+
+    string fileName(const string &name, size_t number) const {
+        return directory + "/maze_bfs." + name + to_string(number);
+    }
 
-            if(this->maze.isValidPosition(i + k, j)) {
-                if(!this->maze.isWall(i + k, j) && !this->isVisited(i + k, j)) {
-                    (*this)[i + k][j] = current;
-                    findPath(Pos(i + k, j), target);
+    string parentsFile() const {
+        return directory + "/maze_bfs.parents";
+    }
+
+    void setParent(Cell c, int d) {
+        uint8_t &byte = ((uint8_t *)parents.data())[c >> 2];
+        int shift = (c & 3) * 2;
+        byte = (byte & ~(3 << shift)) | (d << shift);
+    }
+
+    Direction parent(Cell c) {
+        return Direction((((uint8_t *)parents.data())[c >> 2] >> ((c & 3) * 2)) & 3);
+    }
+
+    // Writes the sorted buffer as run number runs and empties it
+    void writeRun(vector<uint64_t> &buffer, size_t &runs) {
+        sort(buffer.begin(), buffer.end());
+        ValueWriter run(fileName("run", runs++));
+        for(size_t k = 0; k < buffer.size(); k++) {
+            run.put(buffer[k]);
+        }
+        buffer.clear();
+    }
+
+    // Reached cells of the next level into the file of level + 1, each value a
+    // cell shifted left by two above the move into it. Returns their number.
+    size_t nextLevel(size_t level) {
+        vector<uint64_t> buffer;
+        buffer.reserve(bufferValues);
+        size_t runs = 0;
+
+        ValueReader current(fileName("level", level));
+        for(uint64_t value; current.get(value); ) {
+            for(int d = UP; d <= RIGHT; d++) {
+                Cell next = maze.neighbor(Cell(value >> 2), Direction(d));
+                if(maze.isOpen(next)) {
+                    buffer.push_back(uint64_t(next) << 2 | d);
+                    if(buffer.size() == bufferValues) {
+                        writeRun(buffer, runs);
+                    }
                 }
             }
+        }
+        writeRun(buffer, runs);
+
+        vector<ValueReader*> readers;
+        priority_queue<pair<uint64_t, size_t>, vector<pair<uint64_t, size_t> >, greater<pair<uint64_t, size_t> > > heads;
+        for(size_t r = 0; r < runs; r++) {
+            readers.push_back(new ValueReader(fileName("run", r)));
+            uint64_t value;
+            if(readers[r]->get(value)) {
+                heads.push(make_pair(value, r));
+            }
+        }
 
-            if(this->maze.isValidPosition(i, j + k)) {
-                if(!this->maze.isWall(i, j + k) && !this->isVisited(i, j + k)) {
-                    (*this)[i][j + k] = current;
-                    findPath(Pos(i, j + k), target);
-                }
+        // Old levels are read alongside, each a step behind the merged cells
+        ValueReader before(fileName("level", level - 1)), same(fileName("level", level));
+        uint64_t seenBefore = 0, seenSame = 0;
+        bool moreBefore = level > 0 && before.get(seenBefore), moreSame = same.get(seenSame);
+
+        ValueWriter next(fileName("level", level + 1));
+        uint64_t lastCell = UINT64_MAX;
+        while(!heads.empty()) {
+            uint64_t value = heads.top().first;
+            size_t r = heads.top().second;
+            heads.pop();
+            uint64_t refill;
+            if(readers[r]->get(refill)) {
+                heads.push(make_pair(refill, r));
+            }
+
+            uint64_t cell = value >> 2;
+            if(cell == lastCell) {
+                continue; // reached from more than one side
+            }
+            lastCell = cell;
+
+            while(moreBefore && (seenBefore >> 2) < cell) {
+                moreBefore = before.get(seenBefore);
+            }
+            while(moreSame && (seenSame >> 2) < cell) {
+                moreSame = same.get(seenSame);
+            }
+            if((moreBefore && (seenBefore >> 2) == cell) || (moreSame && (seenSame >> 2) == cell)) {
+                continue;
+            }
+
+            next.put(value);
+            setParent(Cell(cell), int(value & 3));
+            if(cell == goal) {
+                length = level + 1;
             }
         }
+
+        for(size_t r = 0; r < runs; r++) {
+            delete readers[r];
+            remove(fileName("run", r).c_str());
+        }
+        return next.count();
     }
-};
 
-class BFSPathFinder : public PathFinder {
 public:
-    BFSPathFinder(Maze &maze_) : PathFinder(maze_) {}
+    // Temporary files and the parent file go to directory. bufferValues bounds
+    // the memory for the neighbors of one level, 8 bytes each.
+    ExternalBFS(const Maze &maze_, const string &directory_, size_t bufferValues_ = 1 << 24) :
+        maze(maze_),
+        directory(directory_),
+        bufferValues(max(size_t(1), bufferValues_)),
+        source(0),
+        goal(0),
+        length(-1) {}
 
-    virtual void findPath(Pos start, Pos target) {
-        this->markVisited(start.i, start.j);
+    // The parents file lasts as long as the search, so pathMoves can read it
+    ~ExternalBFS() {
+        if(parents.data()) {
+            parents.close();
+            remove(parentsFile().c_str());
+        }
+    }
 
-        queue<Pos> q;
-        q.push(start);
+    // Number of moves from start to target, -1 if there is no path
+    long long findPath(Pos startPos, Pos targetPos) {
+        source = maze.cell(startPos.i, startPos.j);
+        goal = maze.cell(targetPos.i, targetPos.j);
+        if(!parents.data() && !parents.create(parentsFile(), (maze.cellCount() + 3) / 4)) {
+            cerr << "Error: cannot create files in " << directory << endl;
+            exit(-1);
+        }
 
-        while(!q.empty()) {
-            Pos current = q.front();
-            q.pop();
+        {
+            ValueWriter first(fileName("level", 0));
+            first.put(uint64_t(source) << 2);
+        }
 
-            if(this->isVisited(target.i, target.j)) {
-                return; // abort if a path to the target cell is already found
+        length = source == goal ? 0 : -1;
+        size_t level = 0;
+        for(size_t reached = 1; reached > 0 && length < 0; level++) {
+            reached = nextLevel(level);
+            if(level > 0) {
+                remove(fileName("level", level - 1).c_str());
             }
+        }
 
-            for(int k = - 1; k <= 1; k += 2) 
-            {
-                int i = current.i;
-                int j = current.j;
+        for(size_t l = level > 0 ? level - 1 : 0; l <= level + 1; l++) {
+            remove(fileName("level", l).c_str());
+        }
+        return length;
+    }
 
-                if(this->maze.isValidPosition(i + k, j)) {
-                    if(!this->maze.isWall(i + k, j) && !this->isVisited(i + k, j)) {
-                        (*this)[i + k][j] = current;
-                        this->markVisited(i + k, j);
-                        q.push(Pos(i + k, j));
-                    }
-                }
+    // Path found by the last findPath as runs of moves, as PathFinder::pathMoves
+    string pathMoves() {
+        string reversed;
+        Cell c = goal;
+        for(long long k = 0; k < length; k++) {
+            Direction d = parent(c);
+            reversed += "ULDR"[d];
+            c = maze.neighbor(c, Direction(d ^ 2));
+        }
 
-                if(this->maze.isValidPosition(i, j + k)) {
-                    if(!this->maze.isWall(i, j + k) && !this->isVisited(i, j + k)) {
-                        (*this)[i][j + k] = current;
-                        this->markVisited(i, j + k);
-                        q.push(Pos(i, j + k));
-                    }
-                }
+        string moves;
+        for(size_t k = reversed.size(); k > 0; ) {
+            char move = reversed[k - 1];
+            size_t run = 0;
+            while(k > 0 && reversed[k - 1] == move) {
+                k--;
+                run++;
+            }
+            moves += move;
+            if(run > 1) {
+                moves += to_string(run);
             }
         }
+        return moves;
     }
 };
 
-int main() {
+// Path length and moves between two cells of the maze in mazeFile, found
+// with ExternalBFS working in directory. Meant for binary maze files, which
+// are mapped instead of read into memory.
+void answerExternal(const string &mazeFile, Pos start, Pos end, const string &directory) {
+    Maze maze = loadMaze(mazeFile);
+    if(!maze.isValidPosition(start.i, start.j) || !maze.isValidPosition(end.i, end.j)) {
+        cerr << "Error: position outside the maze" << endl;
+        exit(-1);
+    }
+
+    ExternalBFS search(maze, directory);
+    long long length = search.findPath(start, end);
+    cout << length << "\n" << search.pathMoves() << endl;
+}
+
+// Answers every query of queryFile (lines of i j i j) against the maze in
+// mazeFile. Queries are grouped by start cell and each group is answered from
+// one BFS tree, the groups spread over the given number of threads. Ends in
+// another part of the maze are told apart by the component labels and never
+// searched for, and queries with a wall at either end are not searched at all.
+// Prints the path length of every query in input order (-1 when there is no
+// path) and the throughput on stderr.
+void answerBatch(const string &mazeFile, const string &queryFile, int threads) {
+    Maze maze = loadMaze(mazeFile);
+    ifstream in(queryFile.c_str());
+    if(!in) {
+        cerr << "Error: cannot open " << queryFile << endl;
+        exit(-1);
+    }
+
+    vector<pair<Pos, Pos> > queries;
+    Pos a, b;
+    while(in >> a.i >> a.j >> b.i >> b.j) {
+        queries.push_back(make_pair(a, b));
+    }
+
+    chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+
+    ComponentIndex components(maze);
+    components.build(threads);
+
+    // Queries by start cell; ones with a wall or out of range start or end have no path
+    vector<long long> lengths(queries.size(), -1);
+    unordered_map<Cell, vector<size_t> > groupOf;
+    for(size_t q = 0; q < queries.size(); q++) {
+        Pos s = queries[q].first, e = queries[q].second;
+        if(maze.isValidPosition(s.i, s.j) && maze.isValidPosition(e.i, e.j) &&
+           !maze.isWall(s.i, s.j) && !maze.isWall(e.i, e.j)) {
+            groupOf[maze.cell(s.i, s.j)].push_back(q);
+        }
+    }
+    vector<vector<size_t> > groups;
+    for(unordered_map<Cell, vector<size_t> >::iterator it = groupOf.begin(); it != groupOf.end(); ++it) {
+        groups.push_back(it->second);
+    }
+
+    atomic<size_t> nextGroup(0);
+    auto worker = [&]() {
+        BFSPathFinder finder(maze);
+        finder.useComponents(&components);
+        for(size_t g = nextGroup++; g < groups.size(); g = nextGroup++) {
+            vector<Pos> targets;
+            for(size_t k = 0; k < groups[g].size(); k++) {
+                targets.push_back(queries[groups[g][k]].second);
+            }
+
+            finder.findPaths(queries[groups[g][0]].first, targets);
+            for(size_t k = 0; k < groups[g].size(); k++) {
+                lengths[groups[g][k]] = finder.pathLength(targets[k]);
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for(int t = 1; t < threads; t++) {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < pool.size(); t++) {
+        pool[t].join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+
+    string out;
+    for(size_t q = 0; q < queries.size(); q++) {
+        out += to_string(lengths[q]) + "\n";
+    }
+    cout << out;
+    cerr << queries.size() << " queries, " << groups.size() << " start cells, " << threads << " threads: "
+         << seconds << " s, " << queries.size() / seconds << " queries/s" << endl;
+}
+
+// Flow field of the maze in mazeFile towards the exits listed in exitFile
+// (lines of i j), printed one row of the maze per line: the move towards the
+// nearest exit as in pathMoves, '*' for an exit, '0' for a wall and '.' for
+// a cell no exit can be reached from
+void writeFlowField(const string &mazeFile, const string &exitFile, int threads) {
+    Maze maze = loadMaze(mazeFile);
+    ifstream in(exitFile.c_str());
+    if(!in) {
+        cerr << "Error: cannot open " << exitFile << endl;
+        exit(-1);
+    }
+
+    vector<Pos> exits;
+    Pos p;
+    while(in >> p.i >> p.j) {
+        exits.push_back(p);
+    }
+
+    FlowField field(maze, threads);
+    double seconds = timed([&]() { field.build(exits); });
+
+    string row;
+    for(int i = 0; i < maze.getSize(); i++) {
+        row.clear();
+        for(int j = 0; j < maze.getSize(); j++) {
+            Pos q(i, j);
+            row += maze.isWall(i, j) ? '0' : field.isSource(q) ? '*' : field.isReachable(q) ? "ULDR"[field.direction(q)] : '.';
+        }
+        row += '\n';
+        cout << row;
+    }
+    cerr << exits.size() << " exits, farthest cell " << field.maxDistance() << " moves away, " << threads
+         << " threads: " << seconds << " s" << endl;
+}
+
+// Finds a shortest path between two cells of the maze in mazeFile, the
+// cheapest one with Dijkstra's algorithm if the maze is weighted, and writes
+// it in one of the formats
+//     grid     the maze with the path drawn as '*', as printPath
+//     coords   one "i j" line per cell of the path
+//     moves    runs of moves as pathMoves
+//     pgm      a PGM image written to outFile
+// to outFile, or to stdout when no outFile is given.
+void writeRoute(const string &mazeFile, Pos start, Pos end, const string &format, const string &outFile) {
+    Maze maze = loadMaze(mazeFile);
+    if(!maze.isValidPosition(start.i, start.j) || !maze.isValidPosition(end.i, end.j)) {
+        cerr << "Error: cell out of the maze" << endl;
+        exit(-1);
+    }
+
+    unique_ptr<PathFinder> search(maze.isWeighted() ? (PathFinder *)new DijkstraPathFinder(maze)
+                                                    : (PathFinder *)new AStarPathFinder(maze));
+    PathFinder &finder = *search;
+    finder.findPath(start, end);
+
+    if(format == "pgm") {
+        if(outFile.empty() || !finder.writePathImage(end, outFile)) {
+            cerr << "Error: cannot write image " << outFile << endl;
+            exit(-1);
+        }
+        return;
+    }
+
+    ofstream file;
+    if(!outFile.empty()) {
+        file.open(outFile.c_str());
+    }
+    ostream &out = outFile.empty() ? cout : file;
+
+    if(format == "grid") {
+        finder.printPath(end, out);
+    }
+    else if(format == "coords") {
+        vector<Pos> cells = finder.path(end);
+        string buffer;
+        for(size_t k = 0; k < cells.size(); k++) {
+            buffer += to_string(cells[k].i) + " " + to_string(cells[k].j) + "\n";
+        }
+        out << buffer;
+    }
+    else if(format == "moves") {
+        out << finder.pathMoves(end) << "\n";
+    }
+    else {
+        cerr << "Error: unknown format " << format << endl;
+        exit(-1);
+    }
+}
+
+// Reads N, k and k walls (i j) without prompts
+Maze readMaze(istream &in) {
+    int N = 0, k = 0;
+    in >> N >> k;
+
+    Maze maze(N);
+    for(int s = 0; s < k; s++) {
+        int i, j;
+        in >> i >> j;
+        maze[i][j] = '0';
+    }
+    return maze;
+}
+
+// Reads a maze and then query pairs (i j i j) from stdin and prints one
+// distance per query, -1 when there is no path. The oracle is loaded from
+// fileName, or built with the given number of landmarks and saved there if
+// the file is missing or belongs to another maze.
+void answerWithOracle(const string &fileName, int landmarks) {
+    Maze maze = readMaze(cin);
+    DistanceOracle oracle(maze);
+
+    if(!oracle.load(fileName)) {
+        oracle.build(landmarks);
+        if(!oracle.save(fileName)) {
+            cerr << "Error: cannot write " << fileName << endl;
+        }
+    }
+
+    Pos a, b;
+    while(cin >> a.i >> a.j >> b.i >> b.j) {
+        cout << oracle.distance(a, b) << "\n";
+    }
+}
+
+// Asks for N and k, then reads k walls or places them at random
+Maze askForMaze() {
     int N, k;
 
     cout << "N = "; 
@@ -188,8 +4033,6 @@ int main() {
     }
 
     Maze maze(N);
-    PathFinder *pathFinder1 = new BFSPathFinder(maze);
-    PathFinder *pathFinder2 = new DFSPathFinder(maze);
 
     // Gather custom input or generate random cells 
     if(yn == 'y') {
@@ -201,17 +4044,73 @@ int main() {
         }
     }
     else {
+        mt19937 rng(2018);
         for(int s = 0; s < k; s++) {
-            int i = rand() % N;
-            int j = rand() % N;
+            int i = rng() % N;
+            int j = rng() % N;
             while(maze[i][j] == '0') {
-                i = rand() % N;
-                j = rand() % N;
+                i = rng() % N;
+                j = rng() % N;
             }
             maze[i][j] = '0';
         }
     }
 
+    return maze;
+}
+
+int main(int argc, char *argv[]) {
+    if(argc == 3 && string(argv[1]) == "--bench") {
+        benchmark(atoi(argv[2]));
+        return 0;
+    }
+    if(argc >= 2 && string(argv[1]) == "--suite") {
+        vector<int> sizes;
+        for(int a = 2; a < argc; a++) {
+            sizes.push_back(atoi(argv[a]));
+        }
+        if(sizes.empty()) {
+            cout << "Sizes 1000 2000 5000; pass larger ones as arguments, e.g. --suite 10000 20000" << endl;
+            sizes = { 1000, 2000, 5000 };
+        }
+        benchmarkSuite(sizes);
+        return 0;
+    }
+    if((argc == 3 || argc == 4) && string(argv[1]) == "--oracle") {
+        answerWithOracle(argv[2], argc == 4 ? atoi(argv[3]) : 16);
+        return 0;
+    }
+
+    if((argc == 4 || argc == 5) && string(argv[1]) == "--batch") {
+        answerBatch(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : max(1, int(thread::hardware_concurrency())));
+        return 0;
+    }
+    if((argc == 8 || argc == 9) && string(argv[1]) == "--route") {
+        writeRoute(argv[2], Pos(atoi(argv[3]), atoi(argv[4])), Pos(atoi(argv[5]), atoi(argv[6])),
+                   argv[7], argc == 9 ? argv[8] : "");
+        return 0;
+    }
+    if((argc == 4 || argc == 5) && string(argv[1]) == "--flow") {
+        writeFlowField(argv[2], argv[3], argc == 5 ? atoi(argv[4]) : max(1, int(thread::hardware_concurrency())));
+        return 0;
+    }
+    if((argc == 7 || argc == 8) && string(argv[1]) == "--external") {
+        answerExternal(argv[2], Pos(atoi(argv[3]), atoi(argv[4])), Pos(atoi(argv[5]), atoi(argv[6])),
+                       argc == 8 ? argv[7] : ".");
+        return 0;
+    }
+    if(argc == 4 && string(argv[1]) == "--convert") {
+        if(!saveBinaryMaze(loadMaze(argv[2]), argv[3])) {
+            cerr << "Error: cannot write " << argv[3] << endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    Maze maze = argc == 3 && string(argv[1]) == "--load" ? loadMaze(argv[2]) : askForMaze();
+    PathFinder *pathFinder1 = new BFSPathFinder(maze);
+    PathFinder *pathFinder2 = new DFSPathFinder(maze);
+
     Pos start, end;
     cout << "Start(i j): ";
     cin >> start.i >> start.j;
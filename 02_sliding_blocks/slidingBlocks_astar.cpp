@@ -2,103 +2,262 @@
 #include <queue>
 #include <vector>
 #include <cstring>
+#include <cstdlib>
 #include <algorithm>
-#include <stack>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <random>
+#include <chrono>
+#include <iomanip>
+#include <climits>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 using namespace std;
 
-class NodeInfo
+// Moves, named after the way the tile next to the blank slides into it.
+// m ^ 1 undoes m.
+enum Move { LEFT, RIGHT, UP, DOWN, NO_MOVE };
+
+const char *moveNames[] = { "left", "right", "up", "down" };
+
+// Whether a tile can slide the way of m into the blank at cell blank of an
+// N x N board, cells numbered row by row
+template<int N>
+bool canMove(int blank, Move m) {
+    switch (m) {
+    case LEFT: return blank % N < N - 1;
+    case RIGHT: return blank % N > 0;
+    case UP: return blank / N < N - 1;
+    case DOWN: return blank / N > 0;
+    default: return false;
+    }
+}
+
+// Cell of the tile that slides the way of m into the blank at cell blank
+template<int N>
+int movedFrom(int blank, Move m) {
+    static const int step[] = { 1, -1, N, -N };
+    return blank + step[m];
+}
+
+// N x N board, the tile at every cell and the cell of the blank (tile 0).
+// Boards up to 4x4 are packed in a single word, larger ones take a byte per
+// tile; both compare and hash as a whole, so they can key a hash map.
+template<int N, bool Packed = (N <= 4)>
+class Board;
+
+// Tile of cell k in bits 4k to 4k + 3, so a move is a shift and a mask
+template<int N>
+class Board<N, true>
 {
-    vector<vector<int>> currentState;
-    vector<vector<int>> prevState;
-    int distance;
-    int size;
+    uint64_t tiles;
+    uint8_t blank;
 
-    bool operator>(const NodeInfo& other) const {
-        int wthis = distance + this->getManh();
-        int wother = other.distance + other.getManh();
+public:
+    Board() : tiles(0), blank(0) {}
 
-        return wthis > wother;
+    int tile(int k) const {
+        return int(tiles >> (4 * k)) & 15;
     }
 
-    int getManh() const {
-        int sum = 0;
+    void setTile(int k, int value) {
+        tiles = (tiles & ~(uint64_t(15) << (4 * k))) | (uint64_t(value) << (4 * k));
+        if (value == 0) {
+            blank = uint8_t(k);
+        }
+    }
 
-        for (int i = 0; i < size; i++) {
-            for (int j = 0; j < size; j++) {
-                pair<int, int> realPosition = make_pair(i, j);
-                pair<int, int> neededPosition;
-                int value = currentState[i][j];
+    int getBlank() const {
+        return blank;
+    }
 
-                if (value == 0) {
-                    neededPosition = make_pair(size - 1, size - 1);
-                }
-                else {
-                    neededPosition = make_pair((value - 1) / size, (value - 1) % size);
-                }
+    // Slides the tile at cell k, next to the blank, into the blank
+    void slide(int k) {
+        uint64_t value = (tiles >> (4 * k)) & 15;
+        tiles ^= (value << (4 * k)) | (value << (4 * blank));
+        blank = uint8_t(k);
+    }
 
-                sum += abs(neededPosition.first - realPosition.first) + abs(neededPosition.second - realPosition.second);
-            }
-        }
+    bool operator==(const Board& other) const {
+        return tiles == other.tiles;
+    }
 
-        return sum;
+    size_t hash() const {
+        uint64_t h = (tiles ^ (tiles >> 31)) * 0xBF58476D1CE4E5B9ULL;
+        return size_t(h ^ (h >> 32));
     }
+};
+
+template<int N>
+class Board<N, false>
+{
+    uint8_t tiles[N * N];
+    uint8_t blank;
 
 public:
-    NodeInfo(int size) : 
-        distance(0),
-        size(size),
-        currentState(vector<vector<int>>(size, vector<int>(size, -1))), 
-        prevState(vector<vector<int>>(size, vector<int>(size, -1))) 
-    {
+    Board() : blank(0) {
+        memset(tiles, 0, sizeof(tiles));
+    }
+
+    int tile(int k) const {
+        return tiles[k];
+    }
+
+    void setTile(int k, int value) {
+        tiles[k] = uint8_t(value);
+        if (value == 0) {
+            blank = uint8_t(k);
+        }
+    }
+
+    int getBlank() const {
+        return blank;
+    }
+
+    void slide(int k) {
+        tiles[blank] = tiles[k];
+        tiles[k] = 0;
+        blank = uint8_t(k);
+    }
 
+    bool operator==(const Board& other) const {
+        return memcmp(tiles, other.tiles, sizeof(tiles)) == 0;
     }
 
-    void setCurrentState(const vector<vector<int>>& state) {
-        if (state.size() != size) {
-            cerr << "Error: Trying to setCurrentState with different dimensions" << endl;
-            exit(-1);
+    // FNV-1a of the tiles
+    size_t hash() const {
+        uint64_t h = 14695981039346656037ULL;
+        for (int k = 0; k < N * N; k++) {
+            h = (h ^ tiles[k]) * 1099511628211ULL;
         }
-        this->currentState = state;
+        return size_t(h);
     }
+};
 
-    const vector<vector<int>>& getCurrentState() const {
-        return currentState;
+template<int N>
+struct BoardHash {
+    size_t operator()(const Board<N>& board) const {
+        return board.hash();
     }
+};
 
-    vector<vector<int>>& getCurrentState() {
-        return currentState;
+// The ordered board, tiles 1 to N * N - 1 row by row and the blank last
+template<int N>
+Board<N> orderedBoard() {
+    Board<N> board;
+    for (int k = 0; k < N * N; k++) {
+        board.setTile(k, (k + 1) % (N * N));
     }
+    return board;
+}
 
-    void setPrevState(const vector<vector<int>>& state) {
-        if (state.size() != size) {
-            cerr << "Error: Trying to setPrevState with different dimensions" << endl;
-            exit(-1);
+// Manhattan distance of every tile from every cell to its cell on the ordered
+// board. The blank counts 0: a move shifts the blank along with a tile, so
+// counting both would overestimate and A* could return a longer path.
+template<int N>
+class ManhattanTable
+{
+    uint8_t distances[N * N][N * N]; // by tile, then cell
+
+    ManhattanTable() {
+        for (int tile = 0; tile < N * N; tile++) {
+            for (int k = 0; k < N * N; k++) {
+                int needed = tile - 1;
+                distances[tile][k] = tile == 0 ? 0 : uint8_t(abs(needed / N - k / N) + abs(needed % N - k % N));
+            }
         }
-        this->prevState = state;
     }
 
-    const vector<vector<int>>& getPrevState() const {
-        return prevState;
+public:
+    static const ManhattanTable& get() {
+        static const ManhattanTable table;
+        return table;
     }
 
-    int getDistance() const {
-        return distance;
+    int distance(int tile, int k) const {
+        return distances[tile][k];
+    }
+
+    // Sum over the tiles of board
+    int sum(const Board<N>& board) const {
+        int total = 0;
+        for (int k = 0; k < N * N; k++) {
+            total += distances[board.tile(k)][k];
+        }
+        return total;
+    }
+
+    // Change of the sum when the tile at cell from slides into the blank
+    int moveChange(const Board<N>& board, int from) const {
+        int tile = board.tile(from);
+        return distances[tile][board.getBlank()] - distances[tile][from];
+    }
+};
+
+// Whether board can be ordered. A move keeps the parity of the number of
+// tile pairs out of order plus, on boards of even width, the row of the blank.
+template<int N>
+bool isSolvable(const Board<N>& board) {
+    int inversions = 0;
+    for (int a = 0; a < N * N; a++) {
+        for (int b = a + 1; b < N * N; b++) {
+            if (board.tile(a) && board.tile(b) && board.tile(a) > board.tile(b)) {
+                inversions++;
+            }
+        }
     }
+    return (inversions + (N % 2 == 0 ? board.getBlank() / N + 1 : 0)) % 2 == 0;
+}
 
-    void setDistance(int distance) {
-        this->distance = distance;
+// A board reached by the search: the board itself, the number of moves from
+// the start, its Manhattan distance and the move that led to it. The
+// distance is computed once for the start and then updated in O(1) by each
+// move, so comparing nodes in the heap reads two stored sums. A 4x4 node
+// takes 32 bytes.
+template<int N>
+class NodeInfo
+{
+    Board<N> board;
+    int distance;
+    int manhattan;
+    Move move;
+
+    bool operator>(const NodeInfo& other) const {
+        return distance + manhattan > other.distance + other.manhattan;
     }
 
-    int getSize() const {
-        return size;
+public:
+    NodeInfo(const Board<N>& board_ = Board<N>()) :
+        board(board_),
+        distance(0),
+        manhattan(ManhattanTable<N>::get().sum(board_)),
+        move(NO_MOVE)
+    {
+
     }
 
-    bool operator==(const NodeInfo& other) const {
-        return currentState == other.currentState;
+    int getManh() const {
+        return manhattan;
     }
 
-    bool operator!=(const NodeInfo& other) const {
-        return !operator==(other);
+    const Board<N>& getBoard() const {
+        return board;
+    }
+
+    int getDistance() const {
+        return distance;
+    }
+
+    Move getMove() const {
+        return move;
     }
 
     bool operator<(const NodeInfo& other) const {
@@ -106,149 +265,672 @@ public:
     }
 
     bool isFinalState() const {
-        return getManh() == 0;
+        return manhattan == 0;
     }
 
-    pair<int, int> findEmptyBlockPos() const {
-        for (int i = 0; i < size; i++) {
-            for (int j = 0; j < size; j++) {
-                if (currentState[i][j] == 0) {
-                    return make_pair(i, j);
-                }
+    // Fills next with the boards one move away and returns their count
+    int neighbors(NodeInfo next[4]) const {
+        const ManhattanTable<N> &table = ManhattanTable<N>::get();
+        int count = 0;
+
+        for (int m = LEFT; m <= DOWN; m++) {
+            if (canMove<N>(board.getBlank(), Move(m))) {
+                int from = movedFrom<N>(board.getBlank(), Move(m));
+                NodeInfo &node = next[count++];
+                node.board = board;
+                node.board.slide(from);
+                node.distance = distance + 1;
+                node.manhattan = manhattan + table.moveChange(board, from);
+                node.move = Move(m);
             }
         }
+
+        return count;
+    }
+};
+
+// Best known distance to every board reached so far and the move that led to it
+struct Visit {
+    int distance;
+    Move move;
+};
+
+template<int N>
+using ClosedSet = unordered_map<Board<N>, Visit, BoardHash<N>>;
+
+// Moves from the start to board, read back by undoing the recorded moves
+template<int N>
+vector<string> pathMoves(Board<N> board, const ClosedSet<N>& visited) {
+    vector<string> moves;
+
+    for (Move m = visited.find(board)->second.move; m != NO_MOVE; m = visited.find(board)->second.move) {
+        moves.push_back(moveNames[m]);
+        board.slide(movedFrom<N>(board.getBlank(), Move(m ^ 1)));
     }
 
-    vector<NodeInfo> neighbors() const {
-        vector<NodeInfo> Neighbors;
-        pair<int, int> emptyBlockPos = findEmptyBlockPos();
+    reverse(moves.begin(), moves.end());
+    return moves;
+}
 
-        int left = emptyBlockPos.second + 1;
-        int right = emptyBlockPos.second - 1;
-        int up = emptyBlockPos.first + 1;
-        int down = emptyBlockPos.first - 1;
+// A* from start to the ordered board. The closed set is a hash map from the
+// packed board to the best distance found for it, so checking a neighbor costs
+// O(1) instead of a scan of every board seen. A board reached again on a
+// shorter path is updated and queued again; queue entries left behind by such
+// an update are skipped when popped. Fills moves and returns true if the
+// board can be ordered; expanded counts the boards taken from the queue.
+template<int N>
+bool solve(const Board<N>& start, vector<string>& moves, size_t& expanded) {
+    ClosedSet<N> visited;
+    priority_queue<NodeInfo<N>> pq;
+
+    visited[start] = Visit{0, NO_MOVE};
+    pq.push(NodeInfo<N>(start));
+    expanded = 0;
 
-        NodeInfo node(size);
+    while (!pq.empty()) {
+        NodeInfo<N> current = pq.top();
+        pq.pop();
 
-        if (left < size) {
-            node.setCurrentState(this->currentState);
-            swap(node.currentState[emptyBlockPos.first][left],
-                 node.currentState[emptyBlockPos.first][emptyBlockPos.second]);
-            Neighbors.push_back(node);
+        if (current.getDistance() > visited.find(current.getBoard())->second.distance) {
+            continue; // reached again on a shorter path after this entry was queued
         }
-        if (right >= 0) {
-            node.setCurrentState(this->currentState);
-            swap(node.currentState[emptyBlockPos.first][right],
-                 node.currentState[emptyBlockPos.first][emptyBlockPos.second]);
-            Neighbors.push_back(node);
+        expanded++;
+
+        if (current.isFinalState()) {
+            moves = pathMoves(current.getBoard(), visited);
+            return true;
         }
-        if (up < size) {
-            node.setCurrentState(this->currentState);
-            swap(node.currentState[up][emptyBlockPos.second],
-                 node.currentState[emptyBlockPos.first][emptyBlockPos.second]);
-            Neighbors.push_back(node);
+
+        NodeInfo<N> next[4];
+        int count = current.neighbors(next);
+        for (int k = 0; k < count; k++) {
+            NodeInfo<N> &node = next[k];
+            Visit visit = {node.getDistance(), node.getMove()};
+
+            pair<typename ClosedSet<N>::iterator, bool> seen = visited.insert(make_pair(node.getBoard(), visit));
+            if (seen.second || seen.first->second.distance > visit.distance) {
+                seen.first->second = visit;
+                pq.push(node);
+            }
         }
-        if (down >= 0) {
-            node.setCurrentState(this->currentState);
-            swap(node.currentState[down][emptyBlockPos.second],
-                 node.currentState[emptyBlockPos.first][emptyBlockPos.second]);
-            Neighbors.push_back(node);
+    }
+
+    return false;
+}
+
+// Read-only view of a whole file, memory-mapped where the platform allows and
+// read into memory otherwise
+class MappedFile
+{
+    const char *bytes;
+    size_t length;
+    vector<char> copy;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile() : bytes(NULL), length(0) {}
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (bytes && copy.empty()) {
+            munmap((void *)bytes, length);
         }
+#endif
+    }
+
+    bool open(const string& fileName) {
+#ifndef _WIN32
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+
+        length = info.st_size;
+        void *mapped = length ? mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        close(fd);
+        if (mapped != MAP_FAILED) {
+            bytes = (const char *)mapped;
+            return true;
+        }
+#endif
+        ifstream in(fileName.c_str(), ios::binary);
+        copy.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        bytes = copy.data();
+        length = copy.size();
+        return bool(in) || in.eof();
+    }
+
+    const char* data() const {
+        return bytes;
+    }
 
-        return Neighbors;
+    size_t size() const {
+        return length;
     }
 };
 
-const NodeInfo& findPrevNode(const vector<NodeInfo>& visited, const NodeInfo& current) {
-    for (const NodeInfo& node : visited) {
-        if (node.getCurrentState() == current.getPrevState()) {
-            return node;
-        }
+// Index of an arrangement of k tiles over cells of an N x N board, from 0 to
+// (N * N)! / (N * N - k)! - 1: the cell of every tile in turn, counted among
+// the cells the tiles before it left free
+inline uint64_t patternRank(const uint8_t cells[], int k, int boardCells) {
+    uint64_t rank = 0, used = 0;
+    for (int i = 0; i < k; i++) {
+        uint64_t below = used & ((uint64_t(1) << cells[i]) - 1);
+        rank = rank * (boardCells - i) + (cells[i] - __builtin_popcountll(below));
+        used |= uint64_t(1) << cells[i];
     }
+    return rank;
 }
 
-void printPath(NodeInfo& start, NodeInfo& current, vector<NodeInfo> visited) {
-    int size = current.getSize();
-    stack<string> s;
+// Number of arrangements of k tiles over boardCells cells
+inline uint64_t patternEntries(int k, int boardCells) {
+    uint64_t entries = 1;
+    for (int i = 0; i < k; i++) {
+        entries *= boardCells - i;
+    }
+    return entries;
+}
 
-    while (current != start) {
-        pair<int, int> emptyBlockPos = current.findEmptyBlockPos();
+// Additive pattern databases. The tiles are split into disjoint patterns and
+// for every arrangement of a pattern's tiles a table holds the fewest moves of
+// those tiles, the other tiles and the blank being free to be anywhere, that
+// put them in place. Only moves of the pattern's own tiles are counted, so the
+// sum over the patterns is still a lower bound on the moves left, and a much
+// closer one than the Manhattan distance, which it never falls below. A
+// table entry is the excess over the Manhattan distance of the pattern's
+// tiles in pairs of moves (the two always have the same parity), capped at
+// 14, in 4 bits.
+//
+// File layout: "SLIDEPDB", board width and pattern count as 32-bit integers,
+// per pattern its tile count as a 32-bit integer and its tiles in 32 bytes,
+// then the tables one after another, two entries per byte, the lower index
+// in the low 4 bits. The file is mapped, so loading costs no reading.
+template<int N>
+class PatternDatabase
+{
+    struct Pattern {
+        vector<uint8_t> tiles;
+        const uint8_t *table;
+    };
 
-        int left = emptyBlockPos.second - 1;
-        int right = emptyBlockPos.second + 1;
-        int up = emptyBlockPos.first - 1;
-        int down = emptyBlockPos.first + 1;
+    MappedFile file;
+    vector<Pattern> patterns;
+    int patternOfTile[N * N]; // -1 for the blank
 
-        if (left >= 0 && current.getPrevState()[emptyBlockPos.first][left] == 0) {
-            s.push("left");
+public:
+    static const int MAX_TILES = 32;
+
+    // Maps fileName and checks that it holds disjoint patterns for N x N boards
+    bool open(const string& fileName) {
+        if (!file.open(fileName)) {
+            return false;
         }
-        else if (right < size && current.getPrevState()[emptyBlockPos.first][right] == 0) {
-            s.push("right");
+
+        const char *bytes = file.data();
+        size_t offset = 16;
+        uint32_t size = 0, count = 0;
+        if (file.size() < offset || memcmp(bytes, "SLIDEPDB", 8) != 0) {
+            return false;
         }
-        else if (up >= 0 && current.getPrevState()[up][emptyBlockPos.second] == 0) {
-            s.push("up");
+        memcpy(&size, bytes + 8, 4);
+        memcpy(&count, bytes + 12, 4);
+        if (size != N) {
+            return false;
         }
-        else if (down < size && current.getPrevState()[down][emptyBlockPos.second] == 0) {
-            s.push("down");
+
+        fill(patternOfTile, patternOfTile + N * N, -1);
+        patterns.assign(count, Pattern());
+        for (uint32_t p = 0; p < count; p++) {
+            uint32_t k = 0;
+            if (file.size() < offset + 4 + MAX_TILES) {
+                return false;
+            }
+            memcpy(&k, bytes + offset, 4);
+            if (k == 0 || k > MAX_TILES || k >= N * N) {
+                return false;
+            }
+            for (uint32_t i = 0; i < k; i++) {
+                int tile = uint8_t(bytes[offset + 4 + i]);
+                if (tile == 0 || tile >= N * N || patternOfTile[tile] != -1) {
+                    return false;
+                }
+                patterns[p].tiles.push_back(uint8_t(tile));
+                patternOfTile[tile] = p;
+            }
+            offset += 4 + MAX_TILES;
         }
 
-        current.findEmptyBlockPos();
-        current = findPrevNode(visited, current);
+        for (uint32_t p = 0; p < count; p++) {
+            size_t tableBytes = (patternEntries(patterns[p].tiles.size(), N * N) + 1) / 2;
+            if (file.size() < offset + tableBytes) {
+                return false;
+            }
+            patterns[p].table = (const uint8_t *)bytes + offset;
+            offset += tableBytes;
+        }
+        return offset == file.size();
     }
 
-    while (!s.empty()) {
-        cout << s.top() << endl;
-        s.pop();
+    int patternCount() const {
+        return int(patterns.size());
     }
-}
 
-void solve(NodeInfo& start) {
-    vector<NodeInfo> visited;
-    priority_queue<NodeInfo> pq;
+    // Pattern holding tile, -1 if none does
+    int patternOf(int tile) const {
+        return patternOfTile[tile];
+    }
 
-    visited.push_back(start);
-    pq.push(start);
+    // Moves of the tiles of pattern p beyond their Manhattan distance, given
+    // the cell of every tile
+    int extra(int p, const uint8_t where[]) const {
+        const Pattern &pattern = patterns[p];
+        uint8_t cells[MAX_TILES];
+        for (size_t i = 0; i < pattern.tiles.size(); i++) {
+            cells[i] = where[pattern.tiles[i]];
+        }
 
-    while (!pq.empty()) {
-        NodeInfo current = pq.top();
-        pq.pop();
+        uint64_t rank = patternRank(cells, int(pattern.tiles.size()), N * N);
+        return 2 * ((pattern.table[rank >> 1] >> ((rank & 1) * 4)) & 15);
+    }
+};
 
-        if (current.isFinalState()) {
-            cout << current.getDistance() << endl;
-            printPath(start, current, visited);
-            return;
+// Tables of the patterns for N x N boards, built by breadth-first search back
+// from the ordered board over the arrangements of each pattern's tiles, and
+// saved to fileName in the layout PatternDatabase reads. The search of one
+// pattern keeps its table, where 15 marks the arrangements not reached yet,
+// and two levels of arrangements, the cells of the tiles packed 6 bits each.
+template<int N>
+bool buildPatternDatabase(const vector<vector<int>>& patterns, const string& fileName) {
+    const ManhattanTable<N> &manhattan = ManhattanTable<N>::get();
+    ofstream out(fileName.c_str(), ios::binary);
+
+    uint32_t size = N, count = uint32_t(patterns.size());
+    out.write("SLIDEPDB", 8);
+    out.write((const char *)&size, 4);
+    out.write((const char *)&count, 4);
+    for (const vector<int>& tiles : patterns) {
+        uint32_t k = uint32_t(tiles.size());
+        char padded[PatternDatabase<N>::MAX_TILES] = {};
+        copy(tiles.begin(), tiles.end(), padded);
+        out.write((const char *)&k, 4);
+        out.write(padded, sizeof(padded));
+    }
+
+    for (const vector<int>& tiles : patterns) {
+        int k = int(tiles.size());
+        vector<uint8_t> table((patternEntries(k, N * N) + 1) / 2, 0xFF);
+        uint8_t cells[PatternDatabase<N>::MAX_TILES];
+
+        uint64_t packed = 0;
+        for (int i = 0; i < k; i++) {
+            cells[i] = uint8_t(tiles[i] - 1);
+            packed |= uint64_t(cells[i]) << (6 * i);
         }
+        uint64_t rank = patternRank(cells, k, N * N);
+        table[rank >> 1] &= ~(15 << ((rank & 1) * 4));
+
+        vector<uint64_t> frontier(1, packed), next;
+        for (int depth = 0; !frontier.empty(); depth++) {
+            for (uint64_t state : frontier) {
+                uint64_t occupied = 0;
+                int sum = 0;
+                for (int i = 0; i < k; i++) {
+                    cells[i] = uint8_t((state >> (6 * i)) & 63);
+                    occupied |= uint64_t(1) << cells[i];
+                    sum += manhattan.distance(tiles[i], cells[i]);
+                }
 
-        for (NodeInfo &node : current.neighbors()) {
-            if (find(visited.begin(), visited.end(), node) == visited.end()) {
-                node.setDistance(current.getDistance() + 1);
-                node.setPrevState(current.getCurrentState());
-                visited.push_back(node);
-                pq.push(node);
+                for (int i = 0; i < k; i++) {
+                    int from = cells[i];
+                    for (int m = LEFT; m <= DOWN; m++) {
+                        // The tile may slide to any cell next to it that could
+                        // hold the blank, i.e. any not holding a pattern tile
+                        if (!canMove<N>(from, Move(m))) {
+                            continue;
+                        }
+                        int to = movedFrom<N>(from, Move(m));
+                        if (occupied >> to & 1) {
+                            continue;
+                        }
+
+                        cells[i] = uint8_t(to);
+                        rank = patternRank(cells, k, N * N);
+                        uint8_t &entry = table[rank >> 1];
+                        int shift = (rank & 1) * 4;
+                        if ((entry >> shift & 15) == 15) {
+                            int excess = (depth + 1 - (sum - manhattan.distance(tiles[i], from) + manhattan.distance(tiles[i], to))) / 2;
+                            entry = uint8_t((entry & ~(15 << shift)) | (min(excess, 14) << shift));
+                            next.push_back((state & ~(uint64_t(63) << (6 * i))) | (uint64_t(to) << (6 * i)));
+                        }
+                    }
+                    cells[i] = uint8_t(from);
+                }
             }
+
+            frontier.swap(next);
+            next.clear();
+            next.shrink_to_fit();
         }
+
+        out.write((const char *)table.data(), table.size());
     }
+
+    return bool(out);
 }
 
-int main() {
-    int n = 0;
+// Tile splits for the tables: 7-8 for the 15-puzzle and four blocks of 6 for
+// the 24-puzzle
+vector<vector<int>> defaultPatterns(int n) {
+    if (n == 4) {
+        return { { 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } };
+    }
+    if (n == 5) {
+        return { { 1, 2, 6, 7, 11, 12 }, { 3, 4, 5, 8, 9, 10 },
+                 { 13, 14, 15, 18, 19, 20 }, { 16, 17, 21, 22, 23, 24 } };
+    }
+    return {};
+}
 
-    cout << "N = ";
-    cin >> n;
+// Iterative deepening A*: depth-first searches on a single board, each cut off
+// where the distance plus the Manhattan distance exceeds a bound, the bound
+// raised to the smallest value cut off until the ordered board is reached.
+// Moves are made and undone in place and a move undoing the previous one is
+// never tried, so memory stays at the board and the current path however
+// long the search runs. Expands boards again on every iteration, which A*
+// avoids at the cost of keeping every board it saw. With pattern databases
+// the estimate adds their excess over the Manhattan distance; a move changes
+// only the entry of the moved tile's pattern.
+template<int N>
+class IDAStar
+{
+    static const int FOUND = -1;
+
+    Board<N> board;
+    const ManhattanTable<N> &table;
+    const PatternDatabase<N> *databases;
+    uint8_t where[N * N]; // cell of every tile
+    vector<int> extras; // PatternDatabase::extra of every pattern
+    vector<Move> path;
+    int bound;
+    size_t expanded;
+
+    // Searches below board, reached with the moves in path; returns FOUND or
+    // the smallest estimate over the bound
+    int search(int manhattan, int extra, Move last) {
+        int estimate = int(path.size()) + manhattan + extra;
+        if (estimate > bound) {
+            return estimate;
+        }
+        expanded++;
+        if (manhattan == 0) {
+            return FOUND;
+        }
+
+        int blank = board.getBlank();
+        int next = INT_MAX;
+        for (int m = LEFT; m <= DOWN; m++) {
+            if (m == (last ^ 1) || !canMove<N>(blank, Move(m))) {
+                continue;
+            }
+
+            int from = movedFrom<N>(blank, Move(m));
+            int tile = board.tile(from);
+            int change = table.moveChange(board, from);
+            board.slide(from);
+            where[tile] = uint8_t(blank);
+            path.push_back(Move(m));
+
+            int p = databases ? databases->patternOf(tile) : -1;
+            int before = p >= 0 ? extras[p] : 0;
+            if (p >= 0) {
+                extras[p] = databases->extra(p, where);
+            }
+
+            int result = search(manhattan + change, p >= 0 ? extra - before + extras[p] : extra, Move(m));
+            if (result == FOUND) {
+                return FOUND;
+            }
+
+            if (p >= 0) {
+                extras[p] = before;
+            }
+            path.pop_back();
+            where[tile] = uint8_t(from);
+            board.slide(blank);
+            next = min(next, result);
+        }
+        return next;
+    }
+
+public:
+    IDAStar(const PatternDatabase<N> *databases_ = NULL) :
+        table(ManhattanTable<N>::get()),
+        databases(databases_),
+        bound(0),
+        expanded(0)
+    {
+
+    }
+
+    // Same contract as solve
+    bool solve(const Board<N>& start, vector<string>& moves, size_t& expandedBoards) {
+        board = start;
+        path.clear();
+        expanded = 0;
+
+        for (int k = 0; k < N * N; k++) {
+            where[board.tile(k)] = uint8_t(k);
+        }
+        int extra = 0;
+        extras.assign(databases ? databases->patternCount() : 0, 0);
+        for (size_t p = 0; p < extras.size(); p++) {
+            extras[p] = databases->extra(int(p), where);
+            extra += extras[p];
+        }
+
+        int manhattan = table.sum(start);
+        int result = manhattan + extra;
+        do {
+            bound = result;
+            result = search(manhattan, extra, NO_MOVE);
+        } while (result != FOUND && result != INT_MAX);
+
+        moves.clear();
+        for (Move m : path) {
+            moves.push_back(moveNames[m]);
+        }
+        expandedBoards = expanded;
+        return result == FOUND;
+    }
+};
+
+template<int N>
+bool solveIDA(const Board<N>& start, vector<string>& moves, size_t& expanded) {
+    return IDAStar<N>().solve(start, moves, expanded);
+}
+
+// Board scrambled from the ordered one by a random walk of scramble moves
+template<int N>
+Board<N> randomBoard(int scramble, mt19937& rng) {
+    Board<N> board = orderedBoard<N>();
+
+    for (int move = 0; move < scramble; move++) {
+        Move m;
+        do {
+            m = Move(rng() % 4);
+        } while (!canMove<N>(board.getBlank(), m));
+        board.slide(movedFrom<N>(board.getBlank(), m));
+    }
 
-    NodeInfo start(n);
+    return board;
+}
+
+// Uniformly random board that can be ordered
+template<int N>
+Board<N> shuffledBoard(mt19937& rng) {
+    vector<int> tiles(N * N);
+    for (int k = 0; k < N * N; k++) {
+        tiles[k] = k;
+    }
+
+    Board<N> board;
+    do {
+        shuffle(tiles.begin(), tiles.end(), rng);
+        for (int k = 0; k < N * N; k++) {
+            board.setTile(k, tiles[k]);
+        }
+    } while (!isSolvable(board));
+
+    return board;
+}
+
+typedef function<bool(const Board<4>&, vector<string>&, size_t&)> Solver;
+
+void reportSolver(const string& name, Solver solver, const vector<Board<4>>& boards) {
+    double seconds = 0;
+    size_t expanded = 0;
+    long long length = 0;
+
+    for (const Board<4>& board : boards) {
+        vector<string> moves;
+        size_t nodes = 0;
+        chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+        solver(board, moves, nodes);
+        seconds += chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        expanded += nodes;
+        length += moves.size();
+    }
+
+    cout << "  " << setw(6) << left << name << right << setw(10) << seconds / boards.size() << " s, "
+         << setw(10) << expanded / boards.size() << " expanded, path length "
+         << double(length) / boards.size() << " on average" << endl;
+}
+
+// Times the solvers on random 15-puzzle boards, scrambled from the ordered
+// board by random walks and then shuffled at random; the shuffled ones are
+// left to IDA*, A* runs out of memory on most of them. IDA* also runs with
+// the pattern databases in databaseFile, if one is given.
+void benchmark(int instances, const string& databaseFile) {
+    mt19937 rng(2018);
+
+    PatternDatabase<4> databases;
+    if (!databaseFile.empty() && !databases.open(databaseFile)) {
+        cerr << "Error: " << databaseFile << " is not a pattern database for 4x4 boards" << endl;
+        exit(-1);
+    }
+    IDAStar<4> withDatabases(&databases);
+    Solver solveWithDatabases = [&](const Board<4>& start, vector<string>& moves, size_t& expanded) {
+        return withDatabases.solve(start, moves, expanded);
+    };
+
+    for (int scramble = 40; scramble <= 120; scramble += 40) {
+        vector<Board<4>> boards;
+        for (int instance = 0; instance < instances; instance++) {
+            boards.push_back(randomBoard<4>(scramble, rng));
+        }
 
-    for (int i = 0; i < n; i++) {
-        for (int j = 0; j < n; j++) {
-            cin >> start.getCurrentState()[i][j];
+        cout << "15-puzzle, " << scramble << " random moves" << endl;
+        reportSolver("A*", solve<4>, boards);
+        reportSolver("IDA*", solveIDA<4>, boards);
+        if (!databaseFile.empty()) {
+            reportSolver("+PDB", solveWithDatabases, boards);
         }
     }
 
-    solve(start);
+    vector<Board<4>> boards;
+    for (int instance = 0; instance < max(1, instances / 5); instance++) { // most take tens of seconds
+        boards.push_back(shuffledBoard<4>(rng));
+    }
+    cout << "15-puzzle, shuffled" << endl;
+    reportSolver("IDA*", solveIDA<4>, boards);
+    if (!databaseFile.empty()) {
+        reportSolver("+PDB", solveWithDatabases, boards);
+    }
+}
+
+// Solves the N x N board with the given tiles, row by row, with A* or IDA*
+// and prints the moves. IDA* uses the pattern databases in databaseFile, if
+// one is given.
+template<int N>
+int run(const vector<int>& tiles, bool ida, const string& databaseFile) {
+    Board<N> start;
+    for (int k = 0; k < N * N; k++) {
+        start.setTile(k, tiles[k]);
+    }
+
+    PatternDatabase<N> databases;
+    if (!databaseFile.empty() && !databases.open(databaseFile)) {
+        cerr << "Error: " << databaseFile << " is not a pattern database for " << N << "x" << N << " boards" << endl;
+        return -1;
+    }
+
+    vector<string> moves;
+    size_t expanded = 0;
+    IDAStar<N> idaStar(databaseFile.empty() ? NULL : &databases);
+    if (!isSolvable(start) || !(ida ? idaStar.solve(start, moves, expanded) : solve(start, moves, expanded))) {
+        cerr << "Error: The board cannot be ordered" << endl;
+        return -1;
+    }
+
+    cout << moves.size() << endl;
+    for (const string& move : moves) {
+        cout << move << endl;
+    }
 
     return 0;
 }
 
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && argc <= 4 && string(argv[1]) == "--bench") {
+        benchmark(argc >= 3 ? atoi(argv[2]) : 10, argc == 4 ? argv[3] : "");
+        return 0;
+    }
+    if (argc == 4 && string(argv[1]) == "--build-pdb") {
+        int n = atoi(argv[2]);
+        if (n != 4 && n != 5) {
+            cerr << "Error: Pattern databases are built for 4x4 and 5x5 boards" << endl;
+            return -1;
+        }
+        if (!(n == 4 ? buildPatternDatabase<4>(defaultPatterns(4), argv[3]) :
+                       buildPatternDatabase<5>(defaultPatterns(5), argv[3]))) {
+            cerr << "Error: cannot write " << argv[3] << endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    bool ida = (argc == 2 || argc == 3) && string(argv[1]) == "--ida";
+    string databaseFile = ida && argc == 3 ? argv[2] : "";
+    int n = 0;
+
+    cout << "N = ";
+    cin >> n;
+
+    vector<int> tiles(max(n, 0) * max(n, 0));
+    for (int k = 0; k < int(tiles.size()); k++) {
+        cin >> tiles[k];
+    }
+
+    switch (n) {
+    case 2: return run<2>(tiles, ida, databaseFile);
+    case 3: return run<3>(tiles, ida, databaseFile);
+    case 4: return run<4>(tiles, ida, databaseFile);
+    case 5: return run<5>(tiles, ida, databaseFile);
+    case 6: return run<6>(tiles, ida, databaseFile);
+    case 7: return run<7>(tiles, ida, databaseFile);
+    case 8: return run<8>(tiles, ida, databaseFile);
+    default:
+        cerr << "Error: Boards from 2x2 to 8x8 are supported" << endl;
+        return -1;
+    }
+}
+
 /*
 3
 6 2 3